@@ -17,13 +17,28 @@
 #define STBI_WRITE_NO_STDIO
 #include "stb_image_write.h"
 
+#include <errno.h>
 #include <locale.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <malloc.h>
 #include <string.h>
 #include <wchar.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#endif
 
 //////////////////////////////////////////////////////////////////////////
 #define TEXPACKER_NEW(T) (T *)malloc(sizeof(T))
@@ -42,1097 +57,9023 @@ static int texpacker_load_data_buffer( const wchar_t * _path, void ** _buffer, s
     long sz = ftell( f );
     rewind( f );
 
-    void * data_buffer = malloc( sz );
-    fread( data_buffer, 1, sz, f );
-    fclose( f );
-
-    *_buffer = data_buffer;
-    *_len = (size_t)sz;
+    if( sz < 0 )
+    {
+        fclose( f );
 
-    return 0;
-}
-//////////////////////////////////////////////////////////////////////////
-static int texpacker_copy_utf8_to_wchar( const char * _utf8, size_t _size, const wchar_t ** const _unicode )
-{
-    wchar_t * unicode = (wchar_t *)malloc( (_size + 1) * sizeof( wchar_t ) );
+        return 1;
+    }
 
-    wchar_t * unicode_iter = unicode;
-    size_t max_mbs = _size;
-    wchar_t dest;
-    mbstate_t mbs;
-    mbrlen( NULL, 0, &mbs );
+    void * data_buffer = malloc( sz );
 
-    while( max_mbs > 0 )
+    if( data_buffer == NULL && sz != 0 )
     {
-        size_t s = mbrtowc( &dest, _utf8 + _size - max_mbs, max_mbs, &mbs );
+        fclose( f );
 
-        if( s == 0 || s > max_mbs )
-        {
-            break;
-        }
+        return 1;
+    }
 
-        *unicode_iter++ = dest;
+    if( fread( data_buffer, 1, sz, f ) != (size_t)sz )
+    {
+        free( data_buffer );
+        fclose( f );
 
-        max_mbs -= s;
+        return 1;
     }
 
-    *unicode_iter = L'\0';
+    fclose( f );
 
-    *_unicode = unicode;
+    *_buffer = data_buffer;
+    *_len = (size_t)sz;
 
     return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-typedef struct texpacker_atlas_t
+static int texpacker_utf8_to_wchar( const char * _utf8, size_t _size, wchar_t * const _unicode, size_t _capacity )
 {
-    uint32_t index;
+    //decode by hand, mbrtowc depends on the process locale
+    const uint8_t * iter = (const uint8_t *)_utf8;
+    const uint8_t * end = iter + _size;
 
-    uint32_t width;
-    uint32_t height;
-    uint32_t channel;
+    size_t length = 0;
 
-    void * pixels;
+    while( iter != end )
+    {
+        uint32_t code = *iter++;
+        uint32_t follow = 0;
 
-    wchar_t path[FILENAME_MAX];
-} texpacker_atlas_t;
-//////////////////////////////////////////////////////////////////////////
-typedef struct texpacker_atlas_rect_t
-{
-    uint32_t x;
-    uint32_t y;
-    uint32_t u;
-    uint32_t v;
-    uint32_t w;
-    uint32_t h;
+        if( code < 0x80 )
+        {
+            follow = 0;
+        }
+        else if( (code & 0xE0) == 0xC0 )
+        {
+            code &= 0x1F;
+            follow = 1;
+        }
+        else if( (code & 0xF0) == 0xE0 )
+        {
+            code &= 0x0F;
+            follow = 2;
+        }
+        else if( (code & 0xF8) == 0xF0 )
+        {
+            code &= 0x07;
+            follow = 3;
+        }
+        else
+        {
+            return 1;
+        }
 
-    uint32_t state;
-    uint8_t rotate;
+        if( (size_t)(end - iter) < follow )
+        {
+            return 1;
+        }
 
-    struct texpacker_atlas_rect_t * l[4];
-} texpacker_atlas_rect_t;
-//////////////////////////////////////////////////////////////////////////
-typedef struct texpacker_texture_t
-{
-    const wchar_t * path;
+        for( uint32_t i = 0; i != follow; ++i )
+        {
+            uint32_t c = *iter++;
 
-    void * pixels;
-    uint32_t width;
-    uint32_t height;
-    uint32_t channel;
+            if( (c & 0xC0) != 0x80 )
+            {
+                return 1;
+            }
 
-    texpacker_atlas_rect_t * atlas_rect;
-    texpacker_atlas_t * atlas;
-} texpacker_texture_t;
-//////////////////////////////////////////////////////////////////////////
-typedef struct texpacker_in_data_t
-{
-    uint32_t textures_count;
-    texpacker_texture_t * textures;
+            code = (code << 6) | (c & 0x3F);
+        }
 
-    uint32_t atlas_border;
-    uint32_t atlas_max_width;
-    uint32_t atlas_max_height;
-    uint32_t atlas_channels;
+        if( code == 0 || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF) )
+        {
+            return 1;
+        }
 
-    const wchar_t * output_atlas_path;
-    const wchar_t * output_atlas_path_ext;
-    const wchar_t * output_atlas_path_format;
+        if( sizeof( wchar_t ) == 2 && code >= 0x10000 )
+        {
+            if( length + 2 >= _capacity )
+            {
+                return 1;
+            }
 
-    const wchar_t * output_atlas_info;
-} texpacker_in_data_t;
-//////////////////////////////////////////////////////////////////////////
-static int texpacker_load_in_data( const void * _buffer, size_t _len, texpacker_in_data_t * const _data )
-{
-    json_error_t j_error;
-    json_t * j = json_loadb( _buffer, _len, 0, &j_error );
+            code -= 0x10000;
 
-    if( j == NULL )
-    {
-        printf( "json error:\nline: %d\ncolumn: %d\nposition: %d\nsource: %s\n text: %s\n"
-            , j_error.line
-            , j_error.column
-            , j_error.position
-            , j_error.source
-            , j_error.text
-        );
+            _unicode[length++] = (wchar_t)(0xD800 + (code >> 10));
+            _unicode[length++] = (wchar_t)(0xDC00 + (code & 0x3FF));
+        }
+        else
+        {
+            if( length + 1 >= _capacity )
+            {
+                return 1;
+            }
 
-        return 1;
+            _unicode[length++] = (wchar_t)code;
+        }
     }
 
-    json_t * j_textures = json_object_get( j, "textures" );
+    _unicode[length] = L'\0';
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_wchar_to_utf8( const wchar_t * _unicode, char * const _utf8, size_t _capacity )
+{
+    size_t length = 0;
 
-    if( j_textures == NULL )
+    for( const wchar_t * iter = _unicode; *iter != L'\0'; ++iter )
     {
-        return 1;
-    }
+        uint32_t code = (uint32_t)*iter;
 
-    uint32_t textures_count = (uint32_t)json_array_size( j_textures );
+        if( sizeof( wchar_t ) == 2 && code >= 0xD800 && code <= 0xDBFF && iter[1] >= 0xDC00 && iter[1] <= 0xDFFF )
+        {
+            code = 0x10000 + ((code - 0xD800) << 10) + ((uint32_t)iter[1] - 0xDC00);
 
-    texpacker_texture_t * textures = TEXPACKER_NEWN( texpacker_texture_t, textures_count );
+            ++iter;
+        }
 
-    for( uint32_t index = 0; index != textures_count; ++index )
-    {
-        json_t * j_texture_path = json_array_get( j_textures, index );
+        uint8_t bytes[4];
+        size_t count;
 
-        const char * texture_path = json_string_value( j_texture_path );
-        size_t texture_path_len = json_string_length( j_texture_path );
+        if( code < 0x80 )
+        {
+            bytes[0] = (uint8_t)code;
+            count = 1;
+        }
+        else if( code < 0x800 )
+        {
+            bytes[0] = (uint8_t)(0xC0 | (code >> 6));
+            bytes[1] = (uint8_t)(0x80 | (code & 0x3F));
+            count = 2;
+        }
+        else if( code < 0x10000 )
+        {
+            bytes[0] = (uint8_t)(0xE0 | (code >> 12));
+            bytes[1] = (uint8_t)(0x80 | ((code >> 6) & 0x3F));
+            bytes[2] = (uint8_t)(0x80 | (code & 0x3F));
+            count = 3;
+        }
+        else
+        {
+            bytes[0] = (uint8_t)(0xF0 | (code >> 18));
+            bytes[1] = (uint8_t)(0x80 | ((code >> 12) & 0x3F));
+            bytes[2] = (uint8_t)(0x80 | ((code >> 6) & 0x3F));
+            bytes[3] = (uint8_t)(0x80 | (code & 0x3F));
+            count = 4;
+        }
 
-        wchar_t * unicode_texture_path;
-        if( texpacker_copy_utf8_to_wchar( texture_path, texture_path_len, &unicode_texture_path ) != 0 )
+        if( length + count >= _capacity )
         {
             return 1;
         }
 
-        textures[index].path = unicode_texture_path;
+        memcpy( _utf8 + length, bytes, count );
+        length += count;
     }
 
-    _data->textures_count = textures_count;
-    _data->textures = textures;
+    _utf8[length] = '\0';
 
-    json_t * j_atlas = json_object_get( j, "atlas" );
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_copy_utf8_to_wchar( const char * _utf8, size_t _size, wchar_t ** const _unicode )
+{
+    //a code point never takes more wchar units than utf8 bytes
+    wchar_t * unicode = (wchar_t *)malloc( (_size + 1) * sizeof( wchar_t ) );
 
-    if( j_atlas == NULL )
+    if( texpacker_utf8_to_wchar( _utf8, _size, unicode, _size + 1 ) != 0 )
     {
+        free( unicode );
+
         return 1;
     }
 
-    json_t * j_atlas_border = json_object_get( j_atlas, "border" );
-
-    if( j_atlas_border == NULL )
-    {
-        return 1;
-    }    
+    *_unicode = unicode;
 
-    json_t * j_atlas_max_width = json_object_get( j_atlas, "max_width" );
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_string_arena_t
+{
+    char * buffer;
+    uint32_t size;
+    uint32_t capacity;
+
+    uint32_t * table;
+    uint32_t table_count;
+    uint32_t table_capacity;
+} texpacker_string_arena_t;
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_STRING_NONE (~0U)
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_string_hash( const char * _str, size_t _len )
+{
+    uint32_t hash = 2166136261U;
 
-    if( j_atlas_max_width == NULL )
+    for( size_t i = 0; i != _len; ++i )
     {
-        return 1;
+        hash ^= (uint8_t)_str[i];
+        hash *= 16777619U;
     }
 
-    json_t * j_atlas_max_height = json_object_get( j_atlas, "max_height" );
+    return hash;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_string_arena_rehash( texpacker_string_arena_t * const _arena, uint32_t _capacity )
+{
+    uint32_t * table = TEXPACKER_NEWN( uint32_t, _capacity );
 
-    if( j_atlas_max_height == NULL )
+    for( uint32_t i = 0; i != _capacity; ++i )
     {
-        return 1;
+        table[i] = TEXPACKER_STRING_NONE;
     }
 
-    json_t * j_atlas_channels = json_object_get( j_atlas, "channels" );
-
-    if( j_atlas_channels == NULL )
+    for( uint32_t i = 0; i != _arena->table_capacity; ++i )
     {
-        return 1;
-    }
+        uint32_t offset = _arena->table[i];
 
-    _data->atlas_border = (uint32_t)json_integer_value( j_atlas_border );
-    _data->atlas_max_width = (uint32_t)json_integer_value( j_atlas_max_width );
-    _data->atlas_max_height = (uint32_t)json_integer_value( j_atlas_max_height );
-    _data->atlas_channels = (uint32_t)json_integer_value( j_atlas_channels );
+        if( offset == TEXPACKER_STRING_NONE )
+        {
+            continue;
+        }
 
-    json_t * j_output = json_object_get( j, "output" );
+        const char * str = _arena->buffer + offset;
 
-    if( j_output == NULL )
-    {
-        return 1;
-    }
+        uint32_t slot = texpacker_string_hash( str, strlen( str ) ) & (_capacity - 1);
 
-    json_t * j_output_atlas_path = json_object_get( j_output, "atlas_path" );
+        while( table[slot] != TEXPACKER_STRING_NONE )
+        {
+            slot = (slot + 1) & (_capacity - 1);
+        }
 
-    if( j_output_atlas_path == NULL )
-    {
-        return 1;
+        table[slot] = offset;
     }
 
-    const char * output_atlas_path = json_string_value( j_output_atlas_path );
-    size_t output_atlas_path_len = json_string_length( j_output_atlas_path );
+    free( _arena->table );
 
-    wchar_t * unicode_output_atlas_path;
-    if( texpacker_copy_utf8_to_wchar( output_atlas_path, output_atlas_path_len, &unicode_output_atlas_path ) != 0 )
+    _arena->table = table;
+    _arena->table_capacity = _capacity;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_string_arena_intern( texpacker_string_arena_t * const _arena, const char * _str, size_t _len, uint32_t * const _offset )
+{
+    //all paths and group names live in one buffer, textures keep offsets
+    if( (_arena->table_count + 1) * 2 > _arena->table_capacity )
     {
-        return 1;
-    }
-
-    _data->output_atlas_path = unicode_output_atlas_path;
-
-    wchar_t * output_atlas_path_ext = wcsrchr( _data->output_atlas_path, '.' );
+        uint32_t capacity = (_arena->table_capacity == 0) ? 1024 : _arena->table_capacity * 2;
 
-    if( output_atlas_path_ext == NULL )
-    {
-        return 1;
+        texpacker_string_arena_rehash( _arena, capacity );
     }
 
-    _data->output_atlas_path_ext = output_atlas_path_ext;
-
-    json_t * j_output_atlas_path_format = json_object_get( j_output, "atlas_path_format" );
+    uint32_t slot = texpacker_string_hash( _str, _len ) & (_arena->table_capacity - 1);
 
-    if( j_output_atlas_path_format != NULL )
+    for( ;; )
     {
-        const char * output_atlas_path_format = json_string_value( j_output_atlas_path_format );
-        size_t output_atlas_path_format_len = json_string_length( j_output_atlas_path_format );
+        uint32_t offset = _arena->table[slot];
 
-        wchar_t * unicode_output_atlas_path_format;
-        if( texpacker_copy_utf8_to_wchar( output_atlas_path_format, output_atlas_path_format_len, &unicode_output_atlas_path_format ) != 0 )
+        if( offset == TEXPACKER_STRING_NONE )
         {
-            return 1;
+            break;
         }
 
-        _data->output_atlas_path_format = unicode_output_atlas_path_format;
-    }
-    else
-    {
-        _data->output_atlas_path_format = NULL;
-    }
+        const char * str = _arena->buffer + offset;
 
-    json_t * j_output_atlas_info = json_object_get( j_output, "atlas_info" );
+        if( strncmp( str, _str, _len ) == 0 && str[_len] == '\0' )
+        {
+            *_offset = offset;
 
-    if( j_output_atlas_info == NULL )
-    {
-        return 1;
-    }
+            return 0;
+        }
 
-    const char * output_atlas_info = json_string_value( j_output_atlas_info );
-    size_t output_atlas_info_len = json_string_length( j_output_atlas_info );
+        slot = (slot + 1) & (_arena->table_capacity - 1);
+    }
 
-    wchar_t * unicode_output_atlas_info;
-    if( texpacker_copy_utf8_to_wchar( output_atlas_info, output_atlas_info_len, &unicode_output_atlas_info ) != 0 )
+    if( (uint64_t)_arena->size + _len + 1 >= TEXPACKER_STRING_NONE )
     {
         return 1;
     }
 
-    _data->output_atlas_info = unicode_output_atlas_info;
-
-    json_decref( j );
+    uint32_t required = _arena->size + (uint32_t)_len + 1;
 
-    return 0;
-}
-//////////////////////////////////////////////////////////////////////////
-static int texpacker_load_texures_pixels( texpacker_in_data_t * const _data )
-{
-    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    if( required > _arena->capacity )
     {
-        texpacker_texture_t * texture = _data->textures + index;
-
-        const wchar_t * texture_path = texture->path;
+        uint32_t capacity = (_arena->capacity == 0) ? 65536 : _arena->capacity;
 
-        void * texure_buffer;
-        size_t texure_len;
-        if( texpacker_load_data_buffer( texture_path, &texure_buffer, &texure_len ) != 0 )
+        while( capacity < required )
         {
-            return 1;
+            capacity = (capacity > 0x7FFFFFFFU) ? required : capacity * 2;
         }
 
-        int width;
-        int height;
-        int channel;
-        stbi_uc * texture_pixels = stbi_load_from_memory( (stbi_uc *)texure_buffer, texure_len, &width, &height, &channel, 0 );
+        _arena->buffer = (char *)realloc( _arena->buffer, capacity );
+        _arena->capacity = capacity;
+    }
 
-        texture->pixels = (void *)texture_pixels;
-        texture->width = (uint32_t)width;
-        texture->height = (uint32_t)height;
-        texture->channel = (uint32_t)channel;
-        texture->atlas_rect = NULL;
-        texture->atlas = NULL;
+    uint32_t offset = _arena->size;
 
-        printf( "%ls w %dx%d [%d]\n", texture_path, width, height, channel );
-    }
+    memcpy( _arena->buffer + offset, _str, _len );
+    _arena->buffer[offset + _len] = '\0';
+    _arena->size = required;
+
+    _arena->table[slot] = offset;
+    ++_arena->table_count;
+
+    *_offset = offset;
 
     return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-static int __max_uint32_t( uint32_t _a, uint32_t _b )
+typedef struct texpacker_palette_stats_t
 {
-    return _a > _b ? _a : _b;
-}
+    uint32_t colors;
+    uint32_t exact;
+    double rmse;
+    uint32_t max_error;
+} texpacker_palette_stats_t;
 //////////////////////////////////////////////////////////////////////////
-static int __textures_compare_reverse( void const * _el1, void const * _el2 )
+typedef struct texpacker_atlas_t
+{
+    uint32_t index;
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t channel;
+
+    void * pixels;
+    uint32_t pixels_y;
+    uint32_t pixels_height;
+
+    uint32_t rects_count;
+    struct texpacker_atlas_rect_t * rects;
+
+    wchar_t * path;
+
+    texpacker_palette_stats_t palette;
+} texpacker_atlas_t;
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_RECT_NONE (~0U)
+#define TEXPACKER_PAGE_NONE (~0U)
+#define TEXPACKER_GROUP_NONE (~0U)
+#define TEXPACKER_SHEET_NONE (~0U)
+#define TEXPACKER_MAX_SCALES 8
+#define TEXPACKER_HULL_DEFAULT_VERTICES 8
+#define TEXPACKER_HULL_MAX_VERTICES 64
+#define TEXPACKER_TILES_DEFAULT_SIZE 128
+#define TEXPACKER_TILES_DEFAULT_GUTTER 4
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_atlas_rect_t
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t u;
+    uint32_t v;
+    uint32_t w;
+    uint32_t h;
+
+    uint32_t fit_w;
+    uint32_t fit_h;
+
+    uint32_t state;
+    uint8_t rotate;
+
+    uint32_t parent;
+    uint32_t l[4];
+} texpacker_atlas_rect_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_hull_point_t
+{
+    float x;
+    float y;
+} texpacker_hull_point_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_texture_t
+{
+    uint32_t path;
+
+    void * pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channel;
+    uint32_t pixel_step;
+    uint32_t row_step;
+    uint32_t opaque;
+
+    uint32_t sheet;
+    uint32_t sheet_x;
+    uint32_t sheet_y;
+    uint32_t sheet_width;
+    uint32_t sheet_height;
+    uint32_t sheet_rotate;
+    uint32_t sheet_trim_x;
+    uint32_t sheet_trim_y;
+    uint32_t sheet_source_width;
+    uint32_t sheet_source_height;
+
+    uint32_t trim_x;
+    uint32_t trim_y;
+    uint32_t source_width;
+    uint32_t source_height;
+
+    uint32_t hull_count;
+    texpacker_hull_point_t * hull;
+
+    uint32_t group;
+
+    uint32_t atlas_rect;
+    texpacker_atlas_t * atlas;
+
+    uint64_t file_time;
+    uint64_t file_size;
+    uint32_t file_dirty;
+} texpacker_texture_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_sheet_t
+{
+    uint32_t path;
+
+    void * pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channel;
+
+    uint64_t file_time;
+    uint64_t file_size;
+    uint32_t file_dirty;
+} texpacker_sheet_t;
+//////////////////////////////////////////////////////////////////////////
+typedef enum texpacker_size_policy_e
+{
+    TEXPACKER_SIZE_POLICY_POW2,
+    TEXPACKER_SIZE_POLICY_MULTIPLE,
+} texpacker_size_policy_e;
+//////////////////////////////////////////////////////////////////////////
+typedef enum texpacker_border_mode_e
+{
+    TEXPACKER_BORDER_MODE_CLEAR,
+    TEXPACKER_BORDER_MODE_EXTRUDE,
+} texpacker_border_mode_e;
+//////////////////////////////////////////////////////////////////////////
+typedef enum texpacker_effort_e
+{
+    TEXPACKER_EFFORT_FAST,
+    TEXPACKER_EFFORT_DEFAULT,
+    TEXPACKER_EFFORT_MAX,
+} texpacker_effort_e;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_sort_key_t
+{
+    uint64_t key;
+    uint32_t index;
+    uint32_t position;
+} texpacker_sort_key_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_atlas_rect_undo_t
+{
+    uint32_t texture;
+
+    uint32_t rect;
+    texpacker_atlas_rect_t r;
+
+    uint32_t parent;
+    texpacker_atlas_rect_t p;
+} texpacker_atlas_rect_undo_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_pack_state_t
 {
-    texpacker_texture_t * tex1 = (texpacker_texture_t *)_el1;
-    texpacker_texture_t * tex2 = (texpacker_texture_t *)_el2;
+    uint32_t * order;
+    texpacker_sort_key_t * keys;
 
-    uint32_t a1 = tex1->width;
-    uint32_t a2 = tex2->width;
+    uint32_t * width;
+    uint32_t * height;
+    uint32_t * footprint_width;
+    uint32_t * footprint_height;
+    uint32_t * placement;
+    uint32_t * page;
+    uint32_t * group;
+    uint32_t * opaque;
 
-    if( a1 < a2 )
+    uint32_t * group_count;
+    uint32_t * group_cursor;
+
+    uint32_t pending_count;
+    uint32_t * pending;
+
+    uint32_t opaque_pending_offset;
+    uint32_t opaque_pending_count;
+    uint32_t page_opaque;
+
+    uint32_t pages_count;
+
+    uint32_t rects_count;
+    uint32_t rects_capacity;
+    texpacker_atlas_rect_t * rects;
+
+    uint32_t undo_count;
+    uint32_t undo_capacity;
+    texpacker_atlas_rect_undo_t * undo;
+
+    uint32_t bounds_width;
+    uint32_t bounds_height;
+} texpacker_pack_state_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_in_data_t
+{
+    texpacker_string_arena_t strings;
+
+    uint32_t textures_count;
+    texpacker_texture_t * textures;
+
+    uint32_t groups_count;
+    uint32_t * groups;
+
+    uint32_t sheets_count;
+    texpacker_sheet_t * sheets;
+
+    texpacker_pack_state_t * pack;
+
+    uint32_t atlas_border;
+    texpacker_border_mode_e atlas_border_mode;
+    uint32_t atlas_debug_outline;
+    uint32_t atlas_max_width;
+    uint32_t atlas_max_height;
+    uint32_t atlas_channels;
+    texpacker_effort_e atlas_effort;
+    uint32_t atlas_heuristics;
+    uint32_t atlas_time_budget;
+    uint64_t atlas_time_begin;
+    uint32_t atlas_multi_bin;
+    uint32_t atlas_tail_page;
+    uint32_t atlas_tail_max_width;
+    uint32_t atlas_tail_max_height;
+    texpacker_size_policy_e atlas_size_policy;
+    uint32_t atlas_size_multiple;
+    uint32_t atlas_crop;
+    uint32_t atlas_opaque_pages;
+    uint32_t atlas_hull_vertices;
+    uint32_t atlas_hull_alpha;
+    uint32_t atlas_hull_trim;
+    uint32_t atlas_mipmaps;
+    uint32_t atlas_align;
+    uint32_t atlas_scales_count;
+    uint32_t atlas_scales[TEXPACKER_MAX_SCALES];
+    uint32_t atlas_scales_max;
+
+    const wchar_t * output_atlas_path;
+    const wchar_t * output_atlas_path_ext;
+    const wchar_t * output_atlas_path_format;
+    const wchar_t * output_mipmap_path_format;
+    const wchar_t * output_scale_path_format;
+    uint32_t output_strip_height;
+    const wchar_t * output_array_path;
+    uint32_t output_palette;
+    uint32_t output_palette_colors;
+    uint32_t output_palette_dither;
+    uint32_t output_palette_threads;
+    const wchar_t * output_tiles_path;
+    uint32_t output_tiles_size;
+    uint32_t output_tiles_gutter;
+
+    const wchar_t * output_atlas_info;
+
+    const wchar_t * cache_path;
+    uint64_t cache_max_size;
+
+    uint32_t io_threads;
+    uint32_t io_queue_depth;
+
+    struct texpacker_trace_t * trace;
+} texpacker_in_data_t;
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_gcd( uint32_t _a, uint32_t _b )
+{
+    while( _b != 0 )
     {
-        return 1;
+        uint32_t r = _a % _b;
+
+        _a = _b;
+        _b = r;
+    }
+
+    return _a;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_parse_effort( const char * _name, texpacker_effort_e * const _effort )
+{
+    if( strcmp( _name, "fast" ) == 0 )
+    {
+        *_effort = TEXPACKER_EFFORT_FAST;
     }
-    else if( a1 > a2 )
+    else if( strcmp( _name, "default" ) == 0 )
     {
-        return -1;
+        *_effort = TEXPACKER_EFFORT_DEFAULT;
+    }
+    else if( strcmp( _name, "max" ) == 0 )
+    {
+        *_effort = TEXPACKER_EFFORT_MAX;
     }
     else
     {
-        return 0;
+        return 1;
     }
+
+    return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-static int texpacker_load_texures_sort( texpacker_in_data_t * const _data )
+static const char * texpacker_get_string( const texpacker_in_data_t * const _data, uint32_t _offset )
+{
+    return _data->strings.buffer + _offset;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_texture_buffer( const texpacker_in_data_t * const _data, const texpacker_texture_t * _texture, void ** _buffer, size_t * const _len )
 {
-    qsort( _data->textures, _data->textures_count, sizeof( texpacker_texture_t ), &__textures_compare_reverse );
+    const char * path = texpacker_get_string( _data, _texture->path );
 
-    return 0;
+    wchar_t texture_path[FILENAME_MAX];
+    if( texpacker_utf8_to_wchar( path, strlen( path ), texture_path, FILENAME_MAX ) != 0 )
+    {
+        return 1;
+    }
+
+    return texpacker_load_data_buffer( texture_path, _buffer, _len );
 }
 //////////////////////////////////////////////////////////////////////////
-static texpacker_atlas_rect_t * texpacker_make_atlas_rect( uint32_t _x, uint32_t _y, uint32_t _width, uint32_t _height )
+static texpacker_texture_t * texpacker_append_texture( texpacker_in_data_t * const _data, uint32_t * const _capacity, uint32_t _path )
 {
-    texpacker_atlas_rect_t * r = TEXPACKER_NEW( texpacker_atlas_rect_t );
+    if( _data->textures_count == *_capacity )
+    {
+        uint32_t capacity = (*_capacity == 0) ? 1024 : *_capacity * 2;
 
-    r->x = _x;
-    r->y = _y;
-    r->u = ~0U;
-    r->v = ~0U;
-    r->w = _width;
-    r->h = _height;
+        _data->textures = (texpacker_texture_t *)realloc( _data->textures, capacity * sizeof( texpacker_texture_t ) );
+        *_capacity = capacity;
+    }
 
-    r->state = 0x00000000;
-    r->rotate = 0;
+    texpacker_texture_t * texture = _data->textures + _data->textures_count++;
+
+    texture->path = _path;
+    texture->group = TEXPACKER_GROUP_NONE;
+    texture->pixel_step = 0;
+    texture->row_step = 0;
+    texture->opaque = 0;
+    texture->sheet = TEXPACKER_SHEET_NONE;
+    texture->sheet_x = 0;
+    texture->sheet_y = 0;
+    texture->sheet_width = 0;
+    texture->sheet_height = 0;
+    texture->sheet_rotate = 0;
+    texture->sheet_trim_x = 0;
+    texture->sheet_trim_y = 0;
+    texture->sheet_source_width = 0;
+    texture->sheet_source_height = 0;
+    texture->trim_x = 0;
+    texture->trim_y = 0;
+    texture->source_width = 0;
+    texture->source_height = 0;
+    texture->hull_count = 0;
+    texture->hull = NULL;
+
+    return texture;
+}
+//////////////////////////////////////////////////////////////////////////
+static texpacker_texture_t * texpacker_append_sheet_texture( texpacker_in_data_t * const _data, uint32_t * const _capacity, uint32_t * const _sheets_capacity, json_t * _j_sheets, uint32_t _path, const char * _sheet, json_t * _j_rect, json_t * _j_rotate, json_t * _j_trim )
+{
+    if( _sheet == NULL || _j_rect == NULL )
+    {
+        return NULL;
+    }
+
+    json_t * j_rect_x = json_object_get( _j_rect, "x" );
+    json_t * j_rect_y = json_object_get( _j_rect, "y" );
+    json_t * j_rect_w = json_object_get( _j_rect, "w" );
+    json_t * j_rect_h = json_object_get( _j_rect, "h" );
+
+    if( j_rect_x == NULL || j_rect_y == NULL || j_rect_w == NULL || j_rect_h == NULL )
+    {
+        return NULL;
+    }
+
+    uint32_t rect_w = (uint32_t)json_integer_value( j_rect_w );
+    uint32_t rect_h = (uint32_t)json_integer_value( j_rect_h );
+
+    if( rect_w == 0 || rect_h == 0 )
+    {
+        return NULL;
+    }
+
+    //every rect of one file shares a single decoded sheet
+    json_t * j_sheet_id = json_object_get( _j_sheets, _sheet );
+
+    if( j_sheet_id == NULL )
+    {
+        if( _data->sheets_count == *_sheets_capacity )
+        {
+            uint32_t capacity = (*_sheets_capacity == 0) ? 16 : *_sheets_capacity * 2;
+
+            _data->sheets = (texpacker_sheet_t *)realloc( _data->sheets, capacity * sizeof( texpacker_sheet_t ) );
+            *_sheets_capacity = capacity;
+        }
+
+        texpacker_sheet_t * sheet = _data->sheets + _data->sheets_count;
+
+        if( texpacker_string_arena_intern( &_data->strings, _sheet, strlen( _sheet ), &sheet->path ) != 0 )
+        {
+            return NULL;
+        }
+
+        sheet->pixels = NULL;
+        sheet->width = 0;
+        sheet->height = 0;
+        sheet->channel = 0;
+        sheet->file_time = 0;
+        sheet->file_size = 0;
+        sheet->file_dirty = 0;
+
+        j_sheet_id = json_integer( _data->sheets_count++ );
+
+        json_object_set_new( _j_sheets, _sheet, j_sheet_id );
+    }
+
+    texpacker_texture_t * texture = texpacker_append_texture( _data, _capacity, _path );
+
+    //a rotated rect holds the texture transposed, as the atlas writes it
+    uint32_t rotate = _j_rotate != NULL && json_is_true( _j_rotate ) ? 1 : 0;
+
+    texture->sheet = (uint32_t)json_integer_value( j_sheet_id );
+    texture->sheet_x = (uint32_t)json_integer_value( j_rect_x );
+    texture->sheet_y = (uint32_t)json_integer_value( j_rect_y );
+    texture->sheet_width = rotate == 0 ? rect_w : rect_h;
+    texture->sheet_height = rotate == 0 ? rect_h : rect_w;
+    texture->sheet_rotate = rotate;
+
+    //a rect cut from a trimmed atlas keeps where it sat in its original source
+    if( _j_trim != NULL )
+    {
+        json_t * j_trim_x = json_object_get( _j_trim, "x" );
+        json_t * j_trim_y = json_object_get( _j_trim, "y" );
+        json_t * j_trim_w = json_object_get( _j_trim, "w" );
+        json_t * j_trim_h = json_object_get( _j_trim, "h" );
+
+        if( j_trim_x == NULL || j_trim_y == NULL || j_trim_w == NULL || j_trim_h == NULL )
+        {
+            return NULL;
+        }
+
+        uint32_t trim_x = (uint32_t)json_integer_value( j_trim_x );
+        uint32_t trim_y = (uint32_t)json_integer_value( j_trim_y );
+        uint32_t trim_w = (uint32_t)json_integer_value( j_trim_w );
+        uint32_t trim_h = (uint32_t)json_integer_value( j_trim_h );
+
+        if( trim_x > trim_w || texture->sheet_width > trim_w - trim_x || trim_y > trim_h || texture->sheet_height > trim_h - trim_y )
+        {
+            return NULL;
+        }
 
-    return r;
+        texture->sheet_trim_x = trim_x;
+        texture->sheet_trim_y = trim_y;
+        texture->sheet_source_width = trim_w;
+        texture->sheet_source_height = trim_h;
+    }
+
+    return texture;
 }
 //////////////////////////////////////////////////////////////////////////
-static int texpacker_fill_atlas_rect( uint32_t _border, texpacker_atlas_rect_t * _r, int8_t _rotate, const texpacker_texture_t * _t )
+static int texpacker_load_repack( texpacker_in_data_t * const _data, uint32_t * const _capacity, uint32_t * const _sheets_capacity, json_t * _j_sheets, const char * _info, size_t _info_len )
 {
-    if( _r->state != 0x00000000 )
+    wchar_t info_path[FILENAME_MAX];
+    if( texpacker_utf8_to_wchar( _info, _info_len, info_path, FILENAME_MAX ) != 0 )
     {
         return 1;
     }
 
-    uint32_t tw = _t->width + _border * 2;
-    uint32_t th = _t->height + _border * 2;
+    void * info_buffer;
+    size_t info_len;
+    if( texpacker_load_data_buffer( info_path, &info_buffer, &info_len ) != 0 )
+    {
+        printf( "repack: unable to open %s\n", _info );
 
-    if( _rotate == 0 )
+        return 1;
+    }
+
+    json_error_t j_error;
+    json_t * j = json_loadb( info_buffer, info_len, 0, &j_error );
+
+    free( info_buffer );
+
+    if( j == NULL )
     {
-        _r->u = tw;
-        _r->v = th;
+        printf( "repack: json error in %s line %d: %s\n", _info, j_error.line, j_error.text );
+
+        return 1;
     }
-    else
+
+    json_t * j_atlases = json_object_get( j, "atlases" );
+    json_t * j_textures = json_object_get( j, "textures" );
+
+    //a previous atlas info is just a list of sheets and the rects cut from them
+    for( size_t index = 0; index != json_array_size( j_textures ); ++index )
+    {
+        json_t * j_texture = json_array_get( j_textures, index );
+
+        json_t * j_texture_path = json_object_get( j_texture, "path" );
+        json_t * j_texture_atlas = json_object_get( j_texture, "atlas" );
+
+        if( j_texture_path == NULL || j_texture_atlas == NULL )
+        {
+            json_decref( j );
+
+            return 1;
+        }
+
+        json_t * j_atlas = json_array_get( j_atlases, (size_t)json_integer_value( j_texture_atlas ) );
+        json_t * j_atlas_path = json_object_get( j_atlas, "path" );
+
+        uint32_t path;
+        if( texpacker_string_arena_intern( &_data->strings, json_string_value( j_texture_path ), json_string_length( j_texture_path ), &path ) != 0 )
+        {
+            json_decref( j );
+
+            return 1;
+        }
+
+        if( texpacker_append_sheet_texture( _data, _capacity, _sheets_capacity, _j_sheets, path, json_string_value( j_atlas_path ), json_object_get( j_texture, "rect" ), json_object_get( j_texture, "rotate" ), json_object_get( j_texture, "trim" ) ) == NULL )
+        {
+            printf( "repack: bad rect for %s in %s\n", json_string_value( j_texture_path ), _info );
+
+            json_decref( j );
+
+            return 1;
+        }
+    }
+
+    json_decref( j );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_manifest( texpacker_in_data_t * const _data, uint32_t * const _capacity, const char * _manifest, size_t _manifest_len )
+{
+    //one path per line, streamed so the whole list never sits in memory twice
+    wchar_t manifest_path[FILENAME_MAX];
+    if( texpacker_utf8_to_wchar( _manifest, _manifest_len, manifest_path, FILENAME_MAX ) != 0 )
+    {
+        return 1;
+    }
+
+    FILE * f = _wfopen( manifest_path, L"rb" );
+
+    if( f == NULL )
+    {
+        printf( "manifest: unable to open %s\n", _manifest );
+
+        return 1;
+    }
+
+    char line[FILENAME_MAX * 4];
+
+    while( fgets( line, sizeof( line ), f ) != NULL )
+    {
+        size_t len = strlen( line );
+
+        if( len == sizeof( line ) - 1 && line[len - 1] != '\n' && feof( f ) == 0 )
+        {
+            printf( "manifest: line too long in %s\n", _manifest );
+
+            fclose( f );
+
+            return 1;
+        }
+
+        while( len != 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t') )
+        {
+            --len;
+        }
+
+        const char * path = line;
+
+        while( len != 0 && (*path == ' ' || *path == '\t') )
+        {
+            ++path;
+            --len;
+        }
+
+        if( len == 0 || *path == '#' )
+        {
+            continue;
+        }
+
+        uint32_t texture_path;
+        if( texpacker_string_arena_intern( &_data->strings, path, len, &texture_path ) != 0 )
+        {
+            fclose( f );
+
+            return 1;
+        }
+
+        texpacker_append_texture( _data, _capacity, texture_path );
+    }
+
+    fclose( f );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_compare_glob_entry( const void * _left, const void * _right )
+{
+    const char * left = *(const char * const *)_left;
+    const char * right = *(const char * const *)_right;
+
+    return strcmp( left, right );
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_glob_entries_t
+{
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t * paths;
+} texpacker_glob_entries_t;
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_push_glob_entry( texpacker_in_data_t * const _data, texpacker_glob_entries_t * const _entries, const char * _path )
+{
+    if( _entries->count == _entries->capacity )
+    {
+        _entries->capacity = (_entries->capacity == 0) ? 256 : _entries->capacity * 2;
+        _entries->paths = (uint32_t *)realloc( _entries->paths, _entries->capacity * sizeof( uint32_t ) );
+    }
+
+    if( texpacker_string_arena_intern( &_data->strings, _path, strlen( _path ), _entries->paths + _entries->count ) != 0 )
+    {
+        return 1;
+    }
+
+    ++_entries->count;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_list_glob( texpacker_in_data_t * const _data, texpacker_glob_entries_t * const _entries, const char * _glob, size_t _glob_len, size_t _directory_len )
+{
+    char entry_path[FILENAME_MAX * 4];
+
+    if( _glob_len >= sizeof( entry_path ) )
+    {
+        return 1;
+    }
+
+    memcpy( entry_path, _glob, _directory_len );
+
+#ifdef _WIN32
+    wchar_t glob_path[FILENAME_MAX];
+    if( texpacker_utf8_to_wchar( _glob, _glob_len, glob_path, FILENAME_MAX ) != 0 )
+    {
+        return 1;
+    }
+
+    WIN32_FIND_DATAW find_data;
+    HANDLE find = FindFirstFileW( glob_path, &find_data );
+
+    if( find == INVALID_HANDLE_VALUE )
+    {
+        return (GetLastError() == ERROR_FILE_NOT_FOUND) ? 0 : 1;
+    }
+
+    int result = 0;
+
+    do
+    {
+        if( (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 )
+        {
+            continue;
+        }
+
+        if( texpacker_wchar_to_utf8( find_data.cFileName, entry_path + _directory_len, sizeof( entry_path ) - _directory_len ) != 0 )
+        {
+            result = 1;
+
+            break;
+        }
+
+        if( texpacker_push_glob_entry( _data, _entries, entry_path ) != 0 )
+        {
+            result = 1;
+
+            break;
+        }
+    } while( FindNextFileW( find, &find_data ) != 0 );
+
+    FindClose( find );
+
+    return result;
+#else
+    char directory[FILENAME_MAX * 4];
+    memcpy( directory, _glob, _directory_len );
+    directory[_directory_len] = '\0';
+
+    char pattern[FILENAME_MAX * 4];
+    memcpy( pattern, _glob + _directory_len, _glob_len - _directory_len );
+    pattern[_glob_len - _directory_len] = '\0';
+
+    DIR * find = opendir( _directory_len == 0 ? "." : directory );
+
+    if( find == NULL )
+    {
+        return 1;
+    }
+
+    int result = 0;
+
+    for( struct dirent * find_data = readdir( find ); find_data != NULL; find_data = readdir( find ) )
+    {
+        if( strcmp( find_data->d_name, "." ) == 0 || strcmp( find_data->d_name, ".." ) == 0 )
+        {
+            continue;
+        }
+
+        if( fnmatch( pattern, find_data->d_name, 0 ) != 0 )
+        {
+            continue;
+        }
+
+        size_t name_len = strlen( find_data->d_name );
+
+        if( _directory_len + name_len >= sizeof( entry_path ) )
+        {
+            result = 1;
+
+            break;
+        }
+
+        memcpy( entry_path + _directory_len, find_data->d_name, name_len + 1 );
+
+        if( texpacker_push_glob_entry( _data, _entries, entry_path ) != 0 )
+        {
+            result = 1;
+
+            break;
+        }
+    }
+
+    closedir( find );
+
+    return result;
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_glob( texpacker_in_data_t * const _data, uint32_t * const _capacity, const char * _glob, size_t _glob_len )
+{
+    size_t directory_len = _glob_len;
+
+    while( directory_len != 0 && _glob[directory_len - 1] != '/' && _glob[directory_len - 1] != '\\' )
+    {
+        --directory_len;
+    }
+
+    texpacker_glob_entries_t entries;
+    entries.count = 0;
+    entries.capacity = 0;
+    entries.paths = NULL;
+
+    if( texpacker_list_glob( _data, &entries, _glob, _glob_len, directory_len ) != 0 )
+    {
+        printf( "manifest: unable to list %s\n", _glob );
+
+        free( entries.paths );
+
+        return 1;
+    }
+
+    //directory order is filesystem dependent, sort to keep builds reproducible
+    uint32_t names_capacity = entries.count + 1;
+    const char ** names = TEXPACKER_NEWN( const char *, names_capacity );
+
+    for( uint32_t i = 0; i != entries.count; ++i )
+    {
+        names[i] = texpacker_get_string( _data, entries.paths[i] );
+    }
+
+    qsort( names, entries.count, sizeof( const char * ), &texpacker_compare_glob_entry );
+
+    for( uint32_t i = 0; i != entries.count; ++i )
+    {
+        uint32_t path = (uint32_t)(names[i] - _data->strings.buffer);
+
+        texpacker_append_texture( _data, _capacity, path );
+    }
+
+    free( names );
+    free( entries.paths );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_in_data( const void * _buffer, size_t _len, texpacker_in_data_t * const _data )
+{
+    json_error_t j_error;
+    json_t * j = json_loadb( _buffer, _len, 0, &j_error );
+
+    if( j == NULL )
+    {
+        printf( "json error:\nline: %d\ncolumn: %d\nposition: %d\nsource: %s\n text: %s\n"
+            , j_error.line
+            , j_error.column
+            , j_error.position
+            , j_error.source
+            , j_error.text
+        );
+
+        return 1;
+    }
+
+    _data->strings.buffer = NULL;
+    _data->strings.size = 0;
+    _data->strings.capacity = 0;
+    _data->strings.table = NULL;
+    _data->strings.table_count = 0;
+    _data->strings.table_capacity = 0;
+
+    _data->textures_count = 0;
+    _data->textures = NULL;
+
+    _data->sheets_count = 0;
+    _data->sheets = NULL;
+
+    uint32_t textures_capacity = 0;
+    uint32_t sheets_capacity = 0;
+
+    json_t * j_textures = json_object_get( j, "textures" );
+    json_t * j_manifest = json_object_get( j, "manifest" );
+    json_t * j_manifest_glob = json_object_get( j, "manifest_glob" );
+    json_t * j_repack = json_object_get( j, "repack" );
+
+    if( j_textures == NULL && j_manifest == NULL && j_manifest_glob == NULL && j_repack == NULL )
+    {
+        return 1;
+    }
+
+    json_t * j_sheets = json_object();
+
+    uint32_t groups_count = 0;
+    uint32_t groups_capacity = (uint32_t)json_array_size( j_textures ) + 1;
+    uint32_t * groups = TEXPACKER_NEWN( uint32_t, groups_capacity );
+
+    json_t * j_groups = json_object();
+
+    for( size_t index = 0; index != json_array_size( j_textures ); ++index )
+    {
+        json_t * j_texture = json_array_get( j_textures, index );
+
+        json_t * j_texture_path = j_texture;
+        json_t * j_texture_group = NULL;
+        json_t * j_texture_sheet = NULL;
+
+        if( json_is_object( j_texture ) )
+        {
+            j_texture_path = json_object_get( j_texture, "path" );
+            j_texture_group = json_object_get( j_texture, "group" );
+            j_texture_sheet = json_object_get( j_texture, "sheet" );
+        }
+
+        if( j_texture_path == NULL )
+        {
+            return 1;
+        }
+
+        const char * texture_path = json_string_value( j_texture_path );
+        size_t texture_path_len = json_string_length( j_texture_path );
+
+        uint32_t path;
+        if( texpacker_string_arena_intern( &_data->strings, texture_path, texture_path_len, &path ) != 0 )
+        {
+            return 1;
+        }
+
+        texpacker_texture_t * texture;
+
+        //a sheet entry names the texture by path and cuts its pixels from the sheet file
+        if( j_texture_sheet != NULL )
+        {
+            texture = texpacker_append_sheet_texture( _data, &textures_capacity, &sheets_capacity, j_sheets, path, json_string_value( j_texture_sheet ), json_object_get( j_texture, "rect" ), json_object_get( j_texture, "rotate" ), json_object_get( j_texture, "trim" ) );
+
+            if( texture == NULL )
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            texture = texpacker_append_texture( _data, &textures_capacity, path );
+        }
+
+        if( j_texture_group != NULL )
+        {
+            if( !json_is_string( j_texture_group ) )
+            {
+                return 1;
+            }
+
+            const char * texture_group = json_string_value( j_texture_group );
+
+            json_t * j_group_id = json_object_get( j_groups, texture_group );
+
+            if( j_group_id == NULL )
+            {
+                uint32_t group;
+                if( texpacker_string_arena_intern( &_data->strings, texture_group, json_string_length( j_texture_group ), &group ) != 0 )
+                {
+                    return 1;
+                }
+
+                groups[groups_count] = group;
+
+                j_group_id = json_integer( groups_count++ );
+
+                if( json_object_set_new( j_groups, texture_group, j_group_id ) != 0 )
+                {
+                    return 1;
+                }
+            }
+
+            texture->group = (uint32_t)json_integer_value( j_group_id );
+        }
+    }
+
+    json_decref( j_groups );
+
+    for( size_t index = 0; index != json_array_size( j_repack ); ++index )
+    {
+        json_t * j_repack_info = json_array_get( j_repack, index );
+
+        if( texpacker_load_repack( _data, &textures_capacity, &sheets_capacity, j_sheets, json_string_value( j_repack_info ), json_string_length( j_repack_info ) ) != 0 )
+        {
+            return 1;
+        }
+    }
+
+    json_decref( j_sheets );
+
+    if( j_manifest != NULL )
+    {
+        if( texpacker_load_manifest( _data, &textures_capacity, json_string_value( j_manifest ), json_string_length( j_manifest ) ) != 0 )
+        {
+            return 1;
+        }
+    }
+
+    if( j_manifest_glob != NULL )
+    {
+        if( texpacker_load_glob( _data, &textures_capacity, json_string_value( j_manifest_glob ), json_string_length( j_manifest_glob ) ) != 0 )
+        {
+            return 1;
+        }
+    }
+
+    uint32_t textures_count = _data->textures_count;
+
+    //an empty manifest or glob match leaves nothing to lay out
+    if( textures_count == 0 )
+    {
+        printf( "textures: nothing to pack\n" );
+
+        return 1;
+    }
+
+    _data->groups_count = groups_count;
+    _data->groups = groups;
+
+    uint32_t pack_capacity = textures_count + 1;
+
+    texpacker_pack_state_t * pack = TEXPACKER_NEW( texpacker_pack_state_t );
+    pack->order = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->keys = TEXPACKER_NEWN( texpacker_sort_key_t, pack_capacity );
+    pack->width = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->height = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->footprint_width = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->footprint_height = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->placement = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->page = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->group = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->opaque = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->group_count = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->group_cursor = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->pending_count = 0;
+    pack->pending = TEXPACKER_NEWN( uint32_t, pack_capacity );
+    pack->opaque_pending_offset = 0;
+    pack->opaque_pending_count = 0;
+    pack->page_opaque = 0;
+    pack->pages_count = 0;
+    pack->rects_count = 0;
+    pack->rects_capacity = 0;
+    pack->rects = NULL;
+    pack->undo_count = 0;
+    pack->undo_capacity = 0;
+    pack->undo = NULL;
+    pack->bounds_width = 0;
+    pack->bounds_height = 0;
+
+    _data->pack = pack;
+
+    json_t * j_atlas = json_object_get( j, "atlas" );
+
+    if( j_atlas == NULL )
+    {
+        return 1;
+    }
+
+    json_t * j_atlas_border = json_object_get( j_atlas, "border" );
+
+    if( j_atlas_border == NULL )
+    {
+        return 1;
+    }    
+
+    json_t * j_atlas_max_width = json_object_get( j_atlas, "max_width" );
+
+    if( j_atlas_max_width == NULL )
+    {
+        return 1;
+    }
+
+    json_t * j_atlas_max_height = json_object_get( j_atlas, "max_height" );
+
+    if( j_atlas_max_height == NULL )
+    {
+        return 1;
+    }
+
+    json_t * j_atlas_channels = json_object_get( j_atlas, "channels" );
+
+    if( j_atlas_channels == NULL )
+    {
+        return 1;
+    }
+
+    _data->atlas_border = (uint32_t)json_integer_value( j_atlas_border );
+    _data->atlas_max_width = (uint32_t)json_integer_value( j_atlas_max_width );
+    _data->atlas_max_height = (uint32_t)json_integer_value( j_atlas_max_height );
+    _data->atlas_channels = (uint32_t)json_integer_value( j_atlas_channels );
+
+    if( _data->atlas_channels == 0 || _data->atlas_channels > 4 )
+    {
+        return 1;
+    }
+
+    json_t * j_atlas_border_mode = json_object_get( j_atlas, "border_mode" );
+
+    if( j_atlas_border_mode != NULL )
+    {
+        const char * atlas_border_mode = json_string_value( j_atlas_border_mode );
+
+        if( atlas_border_mode == NULL )
+        {
+            return 1;
+        }
+
+        if( strcmp( atlas_border_mode, "clear" ) == 0 )
+        {
+            _data->atlas_border_mode = TEXPACKER_BORDER_MODE_CLEAR;
+        }
+        else if( strcmp( atlas_border_mode, "extrude" ) == 0 )
+        {
+            _data->atlas_border_mode = TEXPACKER_BORDER_MODE_EXTRUDE;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _data->atlas_border_mode = TEXPACKER_BORDER_MODE_CLEAR;
+    }
+
+    json_t * j_atlas_debug_outline = json_object_get( j_atlas, "debug_outline" );
+
+    if( j_atlas_debug_outline != NULL )
+    {
+        _data->atlas_debug_outline = json_is_true( j_atlas_debug_outline ) ? 1 : 0;
+    }
+    else
+    {
+        _data->atlas_debug_outline = 0;
+    }
+
+    json_t * j_atlas_effort = json_object_get( j_atlas, "effort" );
+
+    if( j_atlas_effort != NULL )
+    {
+        const char * atlas_effort = json_string_value( j_atlas_effort );
+
+        if( atlas_effort == NULL || texpacker_parse_effort( atlas_effort, &_data->atlas_effort ) != 0 )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _data->atlas_effort = TEXPACKER_EFFORT_DEFAULT;
+    }
+
+    json_t * j_atlas_heuristics = json_object_get( j_atlas, "heuristics" );
+
+    if( j_atlas_heuristics != NULL )
+    {
+        _data->atlas_heuristics = (uint32_t)json_integer_value( j_atlas_heuristics );
+    }
+    else
+    {
+        _data->atlas_heuristics = 1;
+    }
+
+    json_t * j_atlas_time_budget = json_object_get( j_atlas, "time_budget" );
+
+    if( j_atlas_time_budget != NULL )
+    {
+        _data->atlas_time_budget = (uint32_t)json_integer_value( j_atlas_time_budget );
+    }
+    else
+    {
+        _data->atlas_time_budget = 0;
+    }
+
+    _data->atlas_time_begin = 0;
+
+    json_t * j_atlas_multi_bin = json_object_get( j_atlas, "multi_bin" );
+
+    if( j_atlas_multi_bin != NULL )
+    {
+        _data->atlas_multi_bin = json_is_true( j_atlas_multi_bin ) ? 1 : 0;
+    }
+    else
+    {
+        _data->atlas_multi_bin = 0;
+    }
+
+    _data->atlas_tail_page = TEXPACKER_PAGE_NONE;
+    _data->atlas_tail_max_width = 0;
+    _data->atlas_tail_max_height = 0;
+
+    _data->atlas_size_policy = TEXPACKER_SIZE_POLICY_POW2;
+    _data->atlas_size_multiple = 1;
+
+    json_t * j_atlas_size_policy = json_object_get( j_atlas, "size_policy" );
+
+    if( j_atlas_size_policy != NULL )
+    {
+        const char * atlas_size_policy = json_string_value( j_atlas_size_policy );
+
+        if( atlas_size_policy == NULL )
+        {
+            return 1;
+        }
+
+        if( strcmp( atlas_size_policy, "pow2" ) == 0 )
+        {
+            _data->atlas_size_policy = TEXPACKER_SIZE_POLICY_POW2;
+        }
+        else if( strcmp( atlas_size_policy, "multiple_of_4" ) == 0 )
+        {
+            _data->atlas_size_policy = TEXPACKER_SIZE_POLICY_MULTIPLE;
+            _data->atlas_size_multiple = 4;
+        }
+        else if( strcmp( atlas_size_policy, "multiple_of_N" ) == 0 )
+        {
+            json_t * j_atlas_size_multiple = json_object_get( j_atlas, "size_multiple" );
+
+            if( j_atlas_size_multiple == NULL )
+            {
+                return 1;
+            }
+
+            _data->atlas_size_policy = TEXPACKER_SIZE_POLICY_MULTIPLE;
+            _data->atlas_size_multiple = (uint32_t)json_integer_value( j_atlas_size_multiple );
+
+            if( _data->atlas_size_multiple == 0 )
+            {
+                return 1;
+            }
+        }
+        else if( strcmp( atlas_size_policy, "any" ) == 0 )
+        {
+            _data->atlas_size_policy = TEXPACKER_SIZE_POLICY_MULTIPLE;
+            _data->atlas_size_multiple = 1;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+
+    json_t * j_atlas_crop = json_object_get( j_atlas, "crop" );
+
+    if( j_atlas_crop != NULL )
+    {
+        _data->atlas_crop = json_is_true( j_atlas_crop ) ? 1 : 0;
+    }
+    else
+    {
+        _data->atlas_crop = 0;
+    }
+
+    json_t * j_atlas_opaque_pages = json_object_get( j_atlas, "opaque_pages" );
+
+    if( j_atlas_opaque_pages != NULL )
+    {
+        _data->atlas_opaque_pages = json_is_true( j_atlas_opaque_pages ) ? 1 : 0;
+
+        //opaque pages drop the alpha channel, so there has to be one to drop
+        if( _data->atlas_opaque_pages == 1 && _data->atlas_channels != 2 && _data->atlas_channels != 4 )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _data->atlas_opaque_pages = 0;
+    }
+
+    json_t * j_atlas_hull = json_object_get( j_atlas, "hull" );
+
+    if( j_atlas_hull != NULL )
+    {
+        json_t * j_atlas_hull_vertices = json_object_get( j_atlas_hull, "vertices" );
+
+        if( j_atlas_hull_vertices != NULL )
+        {
+            _data->atlas_hull_vertices = (uint32_t)json_integer_value( j_atlas_hull_vertices );
+        }
+        else
+        {
+            _data->atlas_hull_vertices = TEXPACKER_HULL_DEFAULT_VERTICES;
+        }
+
+        //the bounding box is the fallback hull, so the budget can never go below it
+        if( _data->atlas_hull_vertices < 4 || _data->atlas_hull_vertices > TEXPACKER_HULL_MAX_VERTICES )
+        {
+            return 1;
+        }
+
+        json_t * j_atlas_hull_alpha = json_object_get( j_atlas_hull, "alpha" );
+
+        if( j_atlas_hull_alpha != NULL )
+        {
+            _data->atlas_hull_alpha = (uint32_t)json_integer_value( j_atlas_hull_alpha );
+
+            if( _data->atlas_hull_alpha > 254 )
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            _data->atlas_hull_alpha = 0;
+        }
+
+        json_t * j_atlas_hull_trim = json_object_get( j_atlas_hull, "trim" );
+
+        if( j_atlas_hull_trim != NULL )
+        {
+            _data->atlas_hull_trim = json_is_true( j_atlas_hull_trim ) ? 1 : 0;
+        }
+        else
+        {
+            _data->atlas_hull_trim = 0;
+        }
+    }
+    else
+    {
+        _data->atlas_hull_vertices = 0;
+        _data->atlas_hull_alpha = 0;
+        _data->atlas_hull_trim = 0;
+    }
+
+    json_t * j_atlas_mipmaps = json_object_get( j_atlas, "mipmaps" );
+
+    if( j_atlas_mipmaps != NULL )
+    {
+        _data->atlas_mipmaps = (uint32_t)json_integer_value( j_atlas_mipmaps );
+
+        if( _data->atlas_mipmaps > 16 )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _data->atlas_mipmaps = 0;
+    }
+
+    json_t * j_atlas_mipmaps_align = json_object_get( j_atlas, "mipmaps_align" );
+
+    if( j_atlas_mipmaps_align != NULL && json_is_true( j_atlas_mipmaps_align ) )
+    {
+        _data->atlas_align = 1U << _data->atlas_mipmaps;
+    }
+    else
+    {
+        _data->atlas_align = 1;
+    }
+
+    json_t * j_atlas_scales = json_object_get( j_atlas, "scales" );
+
+    _data->atlas_scales_count = 0;
+    _data->atlas_scales_max = 1;
+
+    if( j_atlas_scales != NULL )
+    {
+        size_t scales_count = json_array_size( j_atlas_scales );
+
+        if( scales_count == 0 || scales_count > TEXPACKER_MAX_SCALES )
+        {
+            return 1;
+        }
+
+        for( size_t index = 0; index != scales_count; ++index )
+        {
+            uint32_t scale = (uint32_t)json_integer_value( json_array_get( j_atlas_scales, index ) );
+
+            if( scale == 0 )
+            {
+                return 1;
+            }
+
+            _data->atlas_scales[index] = scale;
+            _data->atlas_scales_max = scale > _data->atlas_scales_max ? scale : _data->atlas_scales_max;
+        }
+
+        _data->atlas_scales_count = (uint32_t)scales_count;
+
+        //sources are the largest scale, every variant is an integer reduction of the one layout
+        uint32_t scales_align = 1;
+        uint32_t factor_max = 1;
+
+        for( uint32_t index = 0; index != _data->atlas_scales_count; ++index )
+        {
+            uint32_t scale = _data->atlas_scales[index];
+
+            if( _data->atlas_scales_max % scale != 0 )
+            {
+                return 1;
+            }
+
+            //a power of two page only divides evenly by a power of two factor, otherwise variant uvs drift
+            uint32_t scale_factor = _data->atlas_scales_max / scale;
+
+            if( _data->atlas_size_policy == TEXPACKER_SIZE_POLICY_POW2 && (scale_factor & (scale_factor - 1)) != 0 )
+            {
+                return 1;
+            }
+
+            uint32_t factor = scale_factor * _data->atlas_align;
+
+            scales_align = scales_align / __texpacker_gcd( scales_align, factor ) * factor;
+            factor_max = scale_factor > factor_max ? scale_factor : factor_max;
+        }
+
+        _data->atlas_align = scales_align;
+
+        _data->atlas_border = (_data->atlas_border + factor_max - 1) / factor_max * factor_max;
+
+        if( _data->atlas_size_policy == TEXPACKER_SIZE_POLICY_MULTIPLE )
+        {
+            _data->atlas_size_multiple = _data->atlas_size_multiple / __texpacker_gcd( _data->atlas_size_multiple, scales_align ) * scales_align;
+        }
+    }
+
+    json_t * j_output = json_object_get( j, "output" );
+
+    if( j_output == NULL )
+    {
+        return 1;
+    }
+
+    json_t * j_output_atlas_path = json_object_get( j_output, "atlas_path" );
+
+    if( j_output_atlas_path == NULL )
+    {
+        return 1;
+    }
+
+    const char * output_atlas_path = json_string_value( j_output_atlas_path );
+    size_t output_atlas_path_len = json_string_length( j_output_atlas_path );
+
+    wchar_t * unicode_output_atlas_path;
+    if( texpacker_copy_utf8_to_wchar( output_atlas_path, output_atlas_path_len, &unicode_output_atlas_path ) != 0 )
+    {
+        return 1;
+    }
+
+    _data->output_atlas_path = unicode_output_atlas_path;
+
+    wchar_t * output_atlas_path_ext = wcsrchr( _data->output_atlas_path, '.' );
+
+    if( output_atlas_path_ext == NULL )
+    {
+        return 1;
+    }
+
+    _data->output_atlas_path_ext = output_atlas_path_ext;
+
+    json_t * j_output_atlas_path_format = json_object_get( j_output, "atlas_path_format" );
+
+    if( j_output_atlas_path_format != NULL )
+    {
+        const char * output_atlas_path_format = json_string_value( j_output_atlas_path_format );
+        size_t output_atlas_path_format_len = json_string_length( j_output_atlas_path_format );
+
+        wchar_t * unicode_output_atlas_path_format;
+        if( texpacker_copy_utf8_to_wchar( output_atlas_path_format, output_atlas_path_format_len, &unicode_output_atlas_path_format ) != 0 )
+        {
+            return 1;
+        }
+
+        _data->output_atlas_path_format = unicode_output_atlas_path_format;
+    }
+    else
+    {
+        _data->output_atlas_path_format = NULL;
+    }
+
+    json_t * j_output_mipmap_path_format = json_object_get( j_output, "mipmap_path_format" );
+
+    if( j_output_mipmap_path_format != NULL )
+    {
+        const char * output_mipmap_path_format = json_string_value( j_output_mipmap_path_format );
+        size_t output_mipmap_path_format_len = json_string_length( j_output_mipmap_path_format );
+
+        wchar_t * unicode_output_mipmap_path_format;
+        if( texpacker_copy_utf8_to_wchar( output_mipmap_path_format, output_mipmap_path_format_len, &unicode_output_mipmap_path_format ) != 0 )
+        {
+            return 1;
+        }
+
+        _data->output_mipmap_path_format = unicode_output_mipmap_path_format;
+    }
+    else
+    {
+        _data->output_mipmap_path_format = NULL;
+    }
+
+    json_t * j_output_scale_path_format = json_object_get( j_output, "scale_path_format" );
+
+    if( j_output_scale_path_format != NULL )
+    {
+        const char * output_scale_path_format = json_string_value( j_output_scale_path_format );
+        size_t output_scale_path_format_len = json_string_length( j_output_scale_path_format );
+
+        wchar_t * unicode_output_scale_path_format;
+        if( texpacker_copy_utf8_to_wchar( output_scale_path_format, output_scale_path_format_len, &unicode_output_scale_path_format ) != 0 )
+        {
+            return 1;
+        }
+
+        _data->output_scale_path_format = unicode_output_scale_path_format;
+    }
+    else
+    {
+        _data->output_scale_path_format = NULL;
+    }
+
+    json_t * j_output_strip_height = json_object_get( j_output, "strip_height" );
+
+    if( j_output_strip_height != NULL )
+    {
+        _data->output_strip_height = (uint32_t)json_integer_value( j_output_strip_height );
+
+        if( _data->output_strip_height != 0 && (_data->atlas_mipmaps != 0 || _data->atlas_scales_count != 0) )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _data->output_strip_height = 0;
+    }
+
+    json_t * j_output_array_path = json_object_get( j_output, "array_path" );
+
+    if( j_output_array_path != NULL )
+    {
+        const char * output_array_path = json_string_value( j_output_array_path );
+        size_t output_array_path_len = json_string_length( j_output_array_path );
+
+        wchar_t * unicode_output_array_path;
+        if( texpacker_copy_utf8_to_wchar( output_array_path, output_array_path_len, &unicode_output_array_path ) != 0 )
+        {
+            return 1;
+        }
+
+        _data->output_array_path = unicode_output_array_path;
+
+        //layers are gathered from rendered pages, and fewer pages mean fewer layers
+        if( _data->output_strip_height != 0 )
+        {
+            return 1;
+        }
+
+        //every layer of an array shares one format
+        if( _data->atlas_opaque_pages == 1 )
+        {
+            return 1;
+        }
+
+        _data->atlas_multi_bin = 1;
+    }
+    else
+    {
+        _data->output_array_path = NULL;
+    }
+
+    json_t * j_output_palette = json_object_get( j_output, "palette" );
+
+    if( j_output_palette != NULL )
+    {
+        _data->output_palette = 1;
+        _data->output_palette_colors = 256;
+        _data->output_palette_dither = 0;
+        _data->output_palette_threads = 4;
+
+        json_t * j_output_palette_colors = json_object_get( j_output_palette, "colors" );
+
+        if( j_output_palette_colors != NULL )
+        {
+            _data->output_palette_colors = (uint32_t)json_integer_value( j_output_palette_colors );
+        }
+
+        json_t * j_output_palette_dither = json_object_get( j_output_palette, "dither" );
+
+        if( j_output_palette_dither != NULL )
+        {
+            _data->output_palette_dither = json_is_true( j_output_palette_dither ) ? 1 : 0;
+        }
+
+        json_t * j_output_palette_threads = json_object_get( j_output_palette, "threads" );
+
+        if( j_output_palette_threads != NULL )
+        {
+            _data->output_palette_threads = (uint32_t)json_integer_value( j_output_palette_threads );
+        }
+
+        if( _data->output_palette_colors < 2 || _data->output_palette_colors > 256 )
+        {
+            return 1;
+        }
+
+        //the palette is built from the whole page, strips never hold it at once
+        if( _data->output_strip_height != 0 )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _data->output_palette = 0;
+        _data->output_palette_colors = 0;
+        _data->output_palette_dither = 0;
+        _data->output_palette_threads = 0;
+    }
+
+    json_t * j_output_tiles = json_object_get( j_output, "tiles" );
+
+    if( j_output_tiles != NULL )
+    {
+        json_t * j_output_tiles_path = json_object_get( j_output_tiles, "path" );
+
+        if( j_output_tiles_path == NULL )
+        {
+            return 1;
+        }
+
+        const char * output_tiles_path = json_string_value( j_output_tiles_path );
+        size_t output_tiles_path_len = json_string_length( j_output_tiles_path );
+
+        wchar_t * unicode_output_tiles_path;
+        if( texpacker_copy_utf8_to_wchar( output_tiles_path, output_tiles_path_len, &unicode_output_tiles_path ) != 0 )
+        {
+            return 1;
+        }
+
+        _data->output_tiles_path = unicode_output_tiles_path;
+
+        json_t * j_output_tiles_size = json_object_get( j_output_tiles, "size" );
+
+        if( j_output_tiles_size != NULL )
+        {
+            _data->output_tiles_size = (uint32_t)json_integer_value( j_output_tiles_size );
+        }
+        else
+        {
+            _data->output_tiles_size = TEXPACKER_TILES_DEFAULT_SIZE;
+        }
+
+        json_t * j_output_tiles_gutter = json_object_get( j_output_tiles, "gutter" );
+
+        if( j_output_tiles_gutter != NULL )
+        {
+            _data->output_tiles_gutter = (uint32_t)json_integer_value( j_output_tiles_gutter );
+        }
+        else
+        {
+            _data->output_tiles_gutter = TEXPACKER_TILES_DEFAULT_GUTTER;
+        }
+
+        if( _data->output_tiles_size == 0 || _data->output_tiles_size > 4096 || _data->output_tiles_gutter > _data->output_tiles_size )
+        {
+            return 1;
+        }
+
+        //tiles are cut from rendered pages, strips never hold a whole one
+        if( _data->output_strip_height != 0 )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        _data->output_tiles_path = NULL;
+        _data->output_tiles_size = 0;
+        _data->output_tiles_gutter = 0;
+    }
+
+    json_t * j_output_atlas_info = json_object_get( j_output, "atlas_info" );
+
+    if( j_output_atlas_info == NULL )
+    {
+        return 1;
+    }
+
+    const char * output_atlas_info = json_string_value( j_output_atlas_info );
+    size_t output_atlas_info_len = json_string_length( j_output_atlas_info );
+
+    wchar_t * unicode_output_atlas_info;
+    if( texpacker_copy_utf8_to_wchar( output_atlas_info, output_atlas_info_len, &unicode_output_atlas_info ) != 0 )
+    {
+        return 1;
+    }
+
+    _data->output_atlas_info = unicode_output_atlas_info;
+
+    json_t * j_cache = json_object_get( j, "cache" );
+
+    if( j_cache != NULL )
+    {
+        json_t * j_cache_path = json_object_get( j_cache, "path" );
+
+        if( j_cache_path == NULL )
+        {
+            return 1;
+        }
+
+        const char * cache_path = json_string_value( j_cache_path );
+        size_t cache_path_len = json_string_length( j_cache_path );
+
+        wchar_t * unicode_cache_path;
+        if( texpacker_copy_utf8_to_wchar( cache_path, cache_path_len, &unicode_cache_path ) != 0 )
+        {
+            return 1;
+        }
+
+        _data->cache_path = unicode_cache_path;
+
+        json_t * j_cache_max_size = json_object_get( j_cache, "max_size" );
+
+        if( j_cache_max_size != NULL )
+        {
+            _data->cache_max_size = (uint64_t)json_integer_value( j_cache_max_size );
+        }
+        else
+        {
+            _data->cache_max_size = 256ULL * 1024 * 1024;
+        }
+    }
+    else
+    {
+        _data->cache_path = NULL;
+        _data->cache_max_size = 0;
+    }
+
+    _data->io_threads = 4;
+    _data->io_queue_depth = 64;
+
+    json_t * j_io = json_object_get( j, "io" );
+
+    if( j_io != NULL )
+    {
+        json_t * j_io_threads = json_object_get( j_io, "threads" );
+
+        if( j_io_threads != NULL )
+        {
+            if( json_integer_value( j_io_threads ) < 0 )
+            {
+                return 1;
+            }
+
+            _data->io_threads = (uint32_t)json_integer_value( j_io_threads );
+        }
+
+        json_t * j_io_queue_depth = json_object_get( j_io, "queue_depth" );
+
+        if( j_io_queue_depth != NULL )
+        {
+            if( json_integer_value( j_io_queue_depth ) < 0 )
+            {
+                return 1;
+            }
+
+            _data->io_queue_depth = (uint32_t)json_integer_value( j_io_queue_depth );
+        }
+
+        if( _data->io_threads != 0 && _data->io_queue_depth == 0 )
+        {
+            return 1;
+        }
+    }
+
+    _data->trace = NULL;
+
+    json_decref( j );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_CACHE_MAGIC 0x434B5054U
+#define TEXPACKER_CACHE_VERSION 1U
+#define TEXPACKER_CACHE_MAX_DIMENSION (1U << 24)
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_cache_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channel;
+    uint32_t reserved;
+} texpacker_cache_header_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_cache_entry_t
+{
+    const char * key;
+    json_int_t size;
+    json_int_t tick;
+} texpacker_cache_entry_t;
+//////////////////////////////////////////////////////////////////////////
+static uint64_t texpacker_cache_hash( const void * _buffer, size_t _len )
+{
+    const uint8_t * buffer = (const uint8_t *)_buffer;
+
+    uint64_t hash = 14695981039346656037ULL;
+
+    for( size_t index = 0; index != _len; ++index )
+    {
+        hash ^= buffer[index];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_cache_make_path( const texpacker_in_data_t * const _data, const char * _key, wchar_t * const _path )
+{
+    wchar_t key[32];
+
+    size_t key_len = strlen( _key ) < 31 ? strlen( _key ) : 31;
+
+    for( size_t index = 0; index != key_len; ++index )
+    {
+        key[index] = (wchar_t)(uint8_t)_key[index];
+    }
+
+    key[key_len] = L'\0';
+
+    swprintf( _path, FILENAME_MAX, L"%ls/%ls.tpc", _data->cache_path, key );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_cache_load_pixels( const wchar_t * _path, void ** const _pixels, uint32_t * const _width, uint32_t * const _height, uint32_t * const _channel )
+{
+    FILE * f = _wfopen( _path, L"rb" );
+
+    if( f == NULL )
+    {
+        return 1;
+    }
+
+    texpacker_cache_header_t header;
+
+    if( fread( &header, sizeof( header ), 1, f ) != 1 || header.magic != TEXPACKER_CACHE_MAGIC || header.version != TEXPACKER_CACHE_VERSION || header.channel == 0 || header.channel > 4 )
+    {
+        fclose( f );
+
+        return 1;
+    }
+
+    //a corrupt or truncated blob is only a miss, the image is decoded again
+    if( header.width == 0 || header.width > TEXPACKER_CACHE_MAX_DIMENSION || header.height == 0 || header.height > TEXPACKER_CACHE_MAX_DIMENSION )
+    {
+        fclose( f );
+
+        return 1;
+    }
+
+    size_t pixels_size = (size_t)header.width * header.height * header.channel;
+
+    fseek( f, 0, SEEK_END );
+    long blob_size = ftell( f );
+    fseek( f, (long)sizeof( header ), SEEK_SET );
+
+    if( blob_size < 0 || (uint64_t)blob_size != sizeof( header ) + (uint64_t)pixels_size )
+    {
+        fclose( f );
+
+        return 1;
+    }
+
+    void * pixels = malloc( pixels_size );
+
+    if( pixels == NULL )
+    {
+        fclose( f );
+
+        return 1;
+    }
+
+    if( fread( pixels, pixels_size, 1, f ) != 1 )
+    {
+        free( pixels );
+        fclose( f );
+
+        return 1;
+    }
+
+    fclose( f );
+
+    *_pixels = pixels;
+    *_width = header.width;
+    *_height = header.height;
+    *_channel = header.channel;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_cache_save_pixels( const wchar_t * _path, const void * _pixels, uint32_t _width, uint32_t _height, uint32_t _channel, size_t * const _size )
+{
+    FILE * f = _wfopen( _path, L"wb" );
+
+    if( f == NULL )
+    {
+        return 1;
+    }
+
+    texpacker_cache_header_t header;
+    header.magic = TEXPACKER_CACHE_MAGIC;
+    header.version = TEXPACKER_CACHE_VERSION;
+    header.width = _width;
+    header.height = _height;
+    header.channel = _channel;
+    header.reserved = 0;
+
+    size_t pixels_size = (size_t)_width * _height * _channel;
+
+    int res = fwrite( &header, sizeof( header ), 1, f ) == 1 && fwrite( _pixels, pixels_size, 1, f ) == 1;
+
+    fclose( f );
+
+    if( res == 0 )
+    {
+        _wremove( _path );
+
+        return 1;
+    }
+
+    *_size = sizeof( header ) + pixels_size;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static json_t * texpacker_cache_load_index( const texpacker_in_data_t * const _data )
+{
+    wchar_t index_path[FILENAME_MAX];
+    swprintf( index_path, FILENAME_MAX, L"%ls/index.json", _data->cache_path );
+
+    void * index_buffer;
+    size_t index_len;
+    if( texpacker_load_data_buffer( index_path, &index_buffer, &index_len ) == 0 )
+    {
+        json_error_t j_error;
+        json_t * j_index = json_loadb( index_buffer, index_len, 0, &j_error );
+
+        free( index_buffer );
+
+        if( j_index != NULL && json_is_object( json_object_get( j_index, "entries" ) ) == 1 )
+        {
+            return j_index;
+        }
+
+        json_decref( j_index );
+    }
+
+    json_t * j_index = json_object();
+
+    json_object_set_new( j_index, "tick", json_integer( 0 ) );
+    json_object_set_new( j_index, "entries", json_object() );
+
+    return j_index;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_cache_save_index( const texpacker_in_data_t * const _data, const json_t * _index )
+{
+    wchar_t index_path[FILENAME_MAX];
+    swprintf( index_path, FILENAME_MAX, L"%ls/index.json", _data->cache_path );
+
+    FILE * f = _wfopen( index_path, L"wb" );
+
+    if( f == NULL )
+    {
+        return 1;
+    }
+
+    int res = json_dumpf( _index, f, JSON_COMPACT );
+
+    fclose( f );
+
+    if( res != 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_cache_touch( json_t * _index, const char * _key, json_int_t _size )
+{
+    json_int_t tick = json_integer_value( json_object_get( _index, "tick" ) ) + 1;
+
+    json_object_set_new( _index, "tick", json_integer( tick ) );
+
+    json_t * j_entry = json_object();
+    json_object_set_new( j_entry, "size", json_integer( _size ) );
+    json_object_set_new( j_entry, "tick", json_integer( tick ) );
+
+    json_object_set_new( json_object_get( _index, "entries" ), _key, j_entry );
+}
+//////////////////////////////////////////////////////////////////////////
+static int __cache_entries_compare_tick( void const * _el1, void const * _el2 )
+{
+    const texpacker_cache_entry_t * e1 = (const texpacker_cache_entry_t *)_el1;
+    const texpacker_cache_entry_t * e2 = (const texpacker_cache_entry_t *)_el2;
+
+    return (e1->tick > e2->tick) - (e1->tick < e2->tick);
+}
+//////////////////////////////////////////////////////////////////////////
+static int __texpacker_cache_key_valid( const char * _key )
+{
+    for( uint32_t index = 0; index != 16; ++index )
+    {
+        char c = _key[index];
+
+        if( (c < '0' || c > '9') && (c < 'a' || c > 'f') )
+        {
+            return 0;
+        }
+    }
+
+    return _key[16] == '\0';
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_cache_evict( const texpacker_in_data_t * const _data, json_t * _index )
+{
+    json_t * j_entries = json_object_get( _index, "entries" );
+
+    size_t entries_count = json_object_size( j_entries );
+
+    if( entries_count == 0 )
+    {
+        return 0;
+    }
+
+    texpacker_cache_entry_t * entries = TEXPACKER_NEWN( texpacker_cache_entry_t, entries_count );
+
+    uint64_t total_size = 0;
+    size_t index = 0;
+
+    const char * key;
+    json_t * j_entry;
+    json_object_foreach( j_entries, key, j_entry )
+    {
+        //only keys this cache wrote name a blob, anything else in the index never reaches _wremove
+        if( __texpacker_cache_key_valid( key ) == 0 )
+        {
+            continue;
+        }
+
+        entries[index].key = key;
+        entries[index].size = json_integer_value( json_object_get( j_entry, "size" ) );
+        entries[index].tick = json_integer_value( json_object_get( j_entry, "tick" ) );
+
+        total_size += (uint64_t)entries[index].size;
+
+        ++index;
+    }
+
+    entries_count = index;
+
+    qsort( entries, entries_count, sizeof( texpacker_cache_entry_t ), &__cache_entries_compare_tick );
+
+    size_t evicted = 0;
+
+    while( evicted != entries_count && total_size > _data->cache_max_size )
+    {
+        const texpacker_cache_entry_t * entry = entries + evicted;
+
+        wchar_t blob_path[FILENAME_MAX];
+        texpacker_cache_make_path( _data, entry->key, blob_path );
+
+        _wremove( blob_path );
+
+        total_size -= (uint64_t)entry->size;
+
+        char key[32];
+        snprintf( key, sizeof( key ), "%s", entry->key );
+
+        json_object_del( j_entries, key );
+
+        ++evicted;
+    }
+
+    free( entries );
+
+    return (uint32_t)evicted;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_OPAQUE_SCAN_BLOCK 64
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_scan_span_opaque( const uint8_t * _span, size_t _size, uint32_t _channel, uint64_t _mask )
+{
+    size_t words = _size / sizeof( uint64_t );
+
+    size_t word = 0;
+
+    while( word != words )
+    {
+        size_t block_end = words - word > TEXPACKER_OPAQUE_SCAN_BLOCK ? word + TEXPACKER_OPAQUE_SCAN_BLOCK : words;
+
+        uint64_t acc = ~0ULL;
+
+        for( ; word != block_end; ++word )
+        {
+            uint64_t value;
+            memcpy( &value, _span + word * sizeof( uint64_t ), sizeof( value ) );
+
+            acc &= value;
+        }
+
+        if( (acc & _mask) != _mask )
+        {
+            return 0;
+        }
+    }
+
+    for( size_t offset = words * sizeof( uint64_t ) + _channel - 1; offset < _size; offset += _channel )
+    {
+        if( _span[offset] != 0xFF )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_scan_texture_opaque( const texpacker_texture_t * _texture )
+{
+    uint32_t channel = _texture->channel;
+
+    if( channel == 1 || channel == 3 )
+    {
+        return 1;
+    }
+
+    //pixels are 2 or 4 bytes, so every 8 byte word holds whole pixels and one AND folds them all
+    uint8_t lanes[8];
+    for( uint32_t index = 0; index != 8; ++index )
+    {
+        lanes[index] = (index + 1) % channel == 0 ? 0xFF : 0x00;
+    }
+
+    uint64_t mask;
+    memcpy( &mask, lanes, sizeof( mask ) );
+
+    const uint8_t * pixels = (const uint8_t *)_texture->pixels;
+
+    //sheet views are contiguous along rows, or along columns when rotated
+    size_t span_size = (size_t)_texture->width * channel;
+    size_t span_step = _texture->row_step;
+    uint32_t spans = _texture->height;
+
+    if( _texture->pixel_step != channel )
+    {
+        span_size = (size_t)_texture->height * channel;
+        span_step = _texture->pixel_step;
+        spans = _texture->width;
+    }
+
+    if( span_step == span_size )
+    {
+        span_size *= spans;
+        spans = 1;
+    }
+
+    for( uint32_t span = 0; span != spans; ++span )
+    {
+        if( __texpacker_scan_span_opaque( pixels + span * span_step, span_size, channel, mask ) == 0 )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_hull_corner_t
+{
+    int32_t x;
+    int32_t y;
+} texpacker_hull_corner_t;
+//////////////////////////////////////////////////////////////////////////
+static int __hull_corners_compare( const void * _left, const void * _right )
+{
+    const texpacker_hull_corner_t * l = (const texpacker_hull_corner_t *)_left;
+    const texpacker_hull_corner_t * r = (const texpacker_hull_corner_t *)_right;
+
+    if( l->x != r->x )
+    {
+        return l->x < r->x ? -1 : 1;
+    }
+
+    if( l->y != r->y )
+    {
+        return l->y < r->y ? -1 : 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void __texpacker_push_hull_corner( texpacker_hull_corner_t * _corners, uint32_t * const _count, int32_t _x, int32_t _y )
+{
+    texpacker_hull_corner_t * c = _corners + (*_count)++;
+
+    c->x = _x;
+    c->y = _y;
+}
+//////////////////////////////////////////////////////////////////////////
+static void __texpacker_set_hull_point( texpacker_hull_point_t * _point, uint32_t _x, uint32_t _y )
+{
+    _point->x = (float)_x;
+    _point->y = (float)_y;
+}
+//////////////////////////////////////////////////////////////////////////
+static int64_t __texpacker_hull_cross( const texpacker_hull_corner_t * _o, const texpacker_hull_corner_t * _a, const texpacker_hull_corner_t * _b )
+{
+    return (int64_t)(_a->x - _o->x) * (_b->y - _o->y) - (int64_t)(_a->y - _o->y) * (_b->x - _o->x);
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_make_convex_hull( texpacker_hull_corner_t * _corners, uint32_t _count, texpacker_hull_corner_t * _hull )
+{
+    qsort( _corners, _count, sizeof( texpacker_hull_corner_t ), &__hull_corners_compare );
+
+    uint32_t k = 0;
+
+    for( uint32_t index = 0; index != _count; ++index )
+    {
+        while( k >= 2 && __texpacker_hull_cross( _hull + k - 2, _hull + k - 1, _corners + index ) <= 0 )
+        {
+            --k;
+        }
+
+        _hull[k++] = _corners[index];
+    }
+
+    uint32_t lower = k + 1;
+
+    for( uint32_t index = _count - 1; index != 0; --index )
+    {
+        while( k >= lower && __texpacker_hull_cross( _hull + k - 2, _hull + k - 1, _corners + index - 1 ) <= 0 )
+        {
+            --k;
+        }
+
+        _hull[k++] = _corners[index - 1];
+    }
+
+    //the last point closes the loop back onto the first
+    return k - 1;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_simplify_hull( texpacker_hull_point_t * _hull, uint32_t _count, uint32_t _budget, float _min_x, float _min_y, float _max_x, float _max_y )
+{
+    //an edge is collapsed by extending its neighbours to where they meet, so the hull only ever grows
+    while( _count > _budget )
+    {
+        uint32_t best = ~0U;
+        double best_area = 0.0;
+        double best_x = 0.0;
+        double best_y = 0.0;
+
+        for( uint32_t index = 0; index != _count; ++index )
+        {
+            const texpacker_hull_point_t * p0 = _hull + (index + _count - 1) % _count;
+            const texpacker_hull_point_t * p1 = _hull + index;
+            const texpacker_hull_point_t * p2 = _hull + (index + 1) % _count;
+            const texpacker_hull_point_t * p3 = _hull + (index + 2) % _count;
+
+            double d0x = (double)p1->x - p0->x;
+            double d0y = (double)p1->y - p0->y;
+            double d2x = (double)p3->x - p2->x;
+            double d2y = (double)p3->y - p2->y;
+            double ex = (double)p2->x - p1->x;
+            double ey = (double)p2->y - p1->y;
+
+            double denom = d0x * d2y - d0y * d2x;
+
+            if( denom == 0.0 )
+            {
+                continue;
+            }
+
+            double t = (ex * d2y - ey * d2x) / denom;
+            double u = (d0x * ey - d0y * ex) / denom;
+
+            if( t < 0.0 || u < 0.0 )
+            {
+                continue;
+            }
+
+            double x = p1->x + t * d0x;
+            double y = p1->y + t * d0y;
+
+            if( x < _min_x || y < _min_y || x > _max_x || y > _max_y )
+            {
+                continue;
+            }
+
+            double area = fabs( ex * (y - p1->y) - ey * (x - p1->x) ) * 0.5;
+
+            if( best == ~0U || area < best_area )
+            {
+                best = index;
+                best_area = area;
+                best_x = x;
+                best_y = y;
+            }
+        }
+
+        if( best == ~0U )
+        {
+            return 0;
+        }
+
+        _hull[best].x = (float)best_x;
+        _hull[best].y = (float)best_y;
+
+        uint32_t removed = (best + 1) % _count;
+
+        memmove( _hull + removed, _hull + removed + 1, (_count - removed - 1) * sizeof( texpacker_hull_point_t ) );
+
+        --_count;
+    }
+
+    return _count;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_build_texture_hull( const texpacker_in_data_t * const _data, texpacker_texture_t * const _texture )
+{
+    uint32_t width = _texture->width;
+    uint32_t height = _texture->height;
+    uint32_t channel = _texture->channel;
+
+    //a trim carried over from a repacked atlas is the origin any new trim adds to
+    _texture->trim_x = _texture->sheet_trim_x;
+    _texture->trim_y = _texture->sheet_trim_y;
+    _texture->source_width = _texture->sheet_source_width != 0 ? _texture->sheet_source_width : width;
+    _texture->source_height = _texture->sheet_source_height != 0 ? _texture->sheet_source_height : height;
+    _texture->hull_count = 0;
+    _texture->hull = NULL;
+
+    if( _data->atlas_hull_vertices == 0 )
+    {
+        return;
+    }
+
+    uint32_t corners_capacity = height * 4 + 4;
+    texpacker_hull_corner_t * corners = TEXPACKER_NEWN( texpacker_hull_corner_t, corners_capacity );
+    uint32_t corners_count = 0;
+
+    uint32_t x0 = width;
+    uint32_t y0 = height;
+    uint32_t x1 = 0;
+    uint32_t y1 = 0;
+
+    if( channel == 2 || channel == 4 )
+    {
+        const uint8_t * pixels = (const uint8_t *)_texture->pixels;
+
+        uint32_t alpha_offset = channel - 1;
+        uint32_t alpha_threshold = _data->atlas_hull_alpha;
+
+        //only the outermost covered pixel of a row can be on a convex hull
+        for( uint32_t y = 0; y != height; ++y )
+        {
+            const uint8_t * row = pixels + (size_t)y * _texture->row_step + alpha_offset;
+
+            uint32_t pixel_step = _texture->pixel_step;
+
+            uint32_t l = 0;
+
+            while( l != width && row[(size_t)l * pixel_step] <= alpha_threshold )
+            {
+                ++l;
+            }
+
+            if( l == width )
+            {
+                continue;
+            }
+
+            uint32_t r = width - 1;
+
+            while( row[(size_t)r * pixel_step] <= alpha_threshold )
+            {
+                --r;
+            }
+
+            __texpacker_push_hull_corner( corners, &corners_count, (int32_t)l, (int32_t)y );
+            __texpacker_push_hull_corner( corners, &corners_count, (int32_t)l, (int32_t)y + 1 );
+            __texpacker_push_hull_corner( corners, &corners_count, (int32_t)r + 1, (int32_t)y );
+            __texpacker_push_hull_corner( corners, &corners_count, (int32_t)r + 1, (int32_t)y + 1 );
+
+            x0 = l < x0 ? l : x0;
+            x1 = r + 1 > x1 ? r + 1 : x1;
+            y0 = y < y0 ? y : y0;
+            y1 = y + 1;
+        }
+    }
+
+    //opaque formats and fully transparent textures are hulled by their own box
+    if( corners_count == 0 )
+    {
+        x0 = 0;
+        y0 = 0;
+        x1 = width;
+        y1 = height;
+
+        __texpacker_push_hull_corner( corners, &corners_count, 0, 0 );
+        __texpacker_push_hull_corner( corners, &corners_count, (int32_t)width, 0 );
+        __texpacker_push_hull_corner( corners, &corners_count, 0, (int32_t)height );
+        __texpacker_push_hull_corner( corners, &corners_count, (int32_t)width, (int32_t)height );
+    }
+
+    uint32_t convex_capacity = corners_count * 2;
+    texpacker_hull_corner_t * convex = TEXPACKER_NEWN( texpacker_hull_corner_t, convex_capacity );
+
+    uint32_t hull_count = texpacker_make_convex_hull( corners, corners_count, convex );
+
+    free( corners );
+
+    texpacker_hull_point_t * hull = TEXPACKER_NEWN( texpacker_hull_point_t, hull_count );
+
+    for( uint32_t index = 0; index != hull_count; ++index )
+    {
+        hull[index].x = (float)convex[index].x;
+        hull[index].y = (float)convex[index].y;
+    }
+
+    free( convex );
+
+    hull_count = texpacker_simplify_hull( hull, hull_count, _data->atlas_hull_vertices, (float)x0, (float)y0, (float)x1, (float)y1 );
+
+    if( hull_count == 0 )
+    {
+        __texpacker_set_hull_point( hull + 0, x0, y0 );
+        __texpacker_set_hull_point( hull + 1, x1, y0 );
+        __texpacker_set_hull_point( hull + 2, x1, y1 );
+        __texpacker_set_hull_point( hull + 3, x0, y1 );
+
+        hull_count = 4;
+    }
+
+    //packing the hull bounds drops the transparent margin, the info keeps the offset into the source
+    if( _data->atlas_hull_trim == 1 && (x0 != 0 || y0 != 0 || x1 != width || y1 != height) )
+    {
+        uint8_t * pixels = (uint8_t *)_texture->pixels;
+
+        if( _texture->sheet != TEXPACKER_SHEET_NONE )
+        {
+            //a sheet view is shared, so it is narrowed instead of moved
+            _texture->pixels = pixels + (size_t)y0 * _texture->row_step + (size_t)x0 * _texture->pixel_step;
+        }
+        else
+        {
+            size_t row_size = (size_t)width * channel;
+            size_t trim_row_size = (size_t)(x1 - x0) * channel;
+
+            for( uint32_t y = y0; y != y1; ++y )
+            {
+                memmove( pixels + (y - y0) * trim_row_size, pixels + y * row_size + x0 * channel, trim_row_size );
+            }
+
+            _texture->row_step = (uint32_t)trim_row_size;
+        }
+
+        for( uint32_t index = 0; index != hull_count; ++index )
+        {
+            hull[index].x -= (float)x0;
+            hull[index].y -= (float)y0;
+        }
+
+        _texture->width = x1 - x0;
+        _texture->height = y1 - y0;
+        _texture->trim_x += x0;
+        _texture->trim_y += y0;
+    }
+
+    _texture->hull_count = hull_count;
+    _texture->hull = hull;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_finish_texture_pixels( const texpacker_in_data_t * const _data, texpacker_texture_t * const _texture )
+{
+    texpacker_build_texture_hull( _data, _texture );
+
+    _texture->opaque = _data->atlas_opaque_pages == 1 ? texpacker_scan_texture_opaque( _texture ) : 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+typedef HANDLE texpacker_thread_t;
+typedef CRITICAL_SECTION texpacker_mutex_t;
+typedef CONDITION_VARIABLE texpacker_cond_t;
+#else
+typedef pthread_t texpacker_thread_t;
+typedef pthread_mutex_t texpacker_mutex_t;
+typedef pthread_cond_t texpacker_cond_t;
+#endif
+//////////////////////////////////////////////////////////////////////////
+typedef void (*texpacker_thread_proc_t)(void * _ud);
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_thread_desc_t
+{
+    texpacker_thread_proc_t proc;
+    void * ud;
+} texpacker_thread_desc_t;
+//////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+static DWORD WINAPI __texpacker_thread_main( LPVOID _ud )
+{
+    texpacker_thread_desc_t * desc = (texpacker_thread_desc_t *)_ud;
+
+    desc->proc( desc->ud );
+
+    return 0;
+}
+#else
+static void * __texpacker_thread_main( void * _ud )
+{
+    texpacker_thread_desc_t * desc = (texpacker_thread_desc_t *)_ud;
+
+    desc->proc( desc->ud );
+
+    return NULL;
+}
+#endif
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_thread_start( texpacker_thread_t * const _thread, texpacker_thread_desc_t * _desc )
+{
+#ifdef _WIN32
+    HANDLE thread = CreateThread( NULL, 0, &__texpacker_thread_main, _desc, 0, NULL );
+
+    if( thread == NULL )
+    {
+        return 1;
+    }
+
+    *_thread = thread;
+#else
+    if( pthread_create( _thread, NULL, &__texpacker_thread_main, _desc ) != 0 )
+    {
+        return 1;
+    }
+#endif
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_thread_join( texpacker_thread_t _thread )
+{
+#ifdef _WIN32
+    WaitForSingleObject( _thread, INFINITE );
+    CloseHandle( _thread );
+#else
+    pthread_join( _thread, NULL );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_mutex_init( texpacker_mutex_t * const _mutex )
+{
+#ifdef _WIN32
+    InitializeCriticalSection( _mutex );
+#else
+    pthread_mutex_init( _mutex, NULL );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_mutex_destroy( texpacker_mutex_t * const _mutex )
+{
+#ifdef _WIN32
+    DeleteCriticalSection( _mutex );
+#else
+    pthread_mutex_destroy( _mutex );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_mutex_lock( texpacker_mutex_t * const _mutex )
+{
+#ifdef _WIN32
+    EnterCriticalSection( _mutex );
+#else
+    pthread_mutex_lock( _mutex );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_mutex_unlock( texpacker_mutex_t * const _mutex )
+{
+#ifdef _WIN32
+    LeaveCriticalSection( _mutex );
+#else
+    pthread_mutex_unlock( _mutex );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_cond_init( texpacker_cond_t * const _cond )
+{
+#ifdef _WIN32
+    InitializeConditionVariable( _cond );
+#else
+    pthread_cond_init( _cond, NULL );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_cond_destroy( texpacker_cond_t * const _cond )
+{
+#ifdef _WIN32
+    //windows condition variables hold no resources
+    (void)_cond;
+#else
+    pthread_cond_destroy( _cond );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_cond_wait( texpacker_cond_t * const _cond, texpacker_mutex_t * const _mutex )
+{
+#ifdef _WIN32
+    SleepConditionVariableCS( _cond, _mutex, INFINITE );
+#else
+    pthread_cond_wait( _cond, _mutex );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_cond_broadcast( texpacker_cond_t * const _cond )
+{
+#ifdef _WIN32
+    WakeAllConditionVariable( _cond );
+#else
+    pthread_cond_broadcast( _cond );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_TRACE_NONE (~0U)
+#define TEXPACKER_TRACE_MAX_THREADS 256
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_trace_event_t
+{
+    const char * name;
+    uint64_t begin;
+    uint64_t duration;
+    uint32_t thread;
+    uint32_t path;
+    uint32_t atlas;
+    uint32_t width;
+    uint32_t height;
+} texpacker_trace_event_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_trace_t
+{
+    const wchar_t * path;
+    uint64_t origin;
+
+    uint32_t events_count;
+    uint32_t events_capacity;
+    texpacker_trace_event_t * events;
+
+    uint32_t threads_count;
+    uint64_t threads[TEXPACKER_TRACE_MAX_THREADS];
+
+    texpacker_mutex_t mutex;
+} texpacker_trace_t;
+//////////////////////////////////////////////////////////////////////////
+static uint64_t texpacker_get_time_us( void )
+{
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t texpacker_get_thread_id( void )
+{
+#ifdef _WIN32
+    return (uint64_t)GetCurrentThreadId();
+#else
+    return (uint64_t)(uintptr_t)pthread_self();
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static texpacker_trace_t * texpacker_trace_create( const wchar_t * _path )
+{
+    texpacker_trace_t * trace = TEXPACKER_NEW( texpacker_trace_t );
+
+    trace->path = _path;
+    trace->origin = texpacker_get_time_us();
+
+    trace->events_count = 0;
+    trace->events_capacity = 0;
+    trace->events = NULL;
+
+    //the creating thread is the main one, it always gets row 0
+    trace->threads_count = 1;
+    trace->threads[0] = texpacker_get_thread_id();
+
+    texpacker_mutex_init( &trace->mutex );
+
+    return trace;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_trace_destroy( texpacker_trace_t * _trace )
+{
+    texpacker_mutex_destroy( &_trace->mutex );
+
+    free( _trace->events );
+    free( _trace );
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t texpacker_trace_begin( const texpacker_in_data_t * const _data )
+{
+    //every hook is a single pointer test when tracing is off
+    if( _data->trace == NULL )
+    {
+        return 0;
+    }
+
+    return texpacker_get_time_us();
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_trace_span( const texpacker_in_data_t * const _data, const char * _name, uint64_t _begin, uint32_t _path, uint32_t _atlas, uint32_t _width, uint32_t _height )
+{
+    texpacker_trace_t * trace = _data->trace;
+
+    if( trace == NULL )
+    {
+        return;
+    }
+
+    uint64_t end = texpacker_get_time_us();
+    uint64_t thread_id = texpacker_get_thread_id();
+
+    texpacker_mutex_lock( &trace->mutex );
+
+    //threads get small ids in the order they first report, the viewer lays them out as rows
+    uint32_t thread = 0;
+
+    while( thread != trace->threads_count && trace->threads[thread] != thread_id )
+    {
+        ++thread;
+    }
+
+    if( thread == trace->threads_count && trace->threads_count != TEXPACKER_TRACE_MAX_THREADS )
+    {
+        trace->threads[trace->threads_count++] = thread_id;
+    }
+
+    if( trace->events_count == trace->events_capacity )
+    {
+        trace->events_capacity = trace->events_capacity != 0 ? trace->events_capacity * 2 : 1024;
+
+        trace->events = (texpacker_trace_event_t *)realloc( trace->events, trace->events_capacity * sizeof( texpacker_trace_event_t ) );
+    }
+
+    texpacker_trace_event_t * event = trace->events + trace->events_count++;
+
+    event->name = _name;
+    event->begin = _begin - trace->origin;
+    event->duration = end - _begin;
+    event->thread = thread;
+    event->path = _path;
+    event->atlas = _atlas;
+    event->width = _width;
+    event->height = _height;
+
+    texpacker_mutex_unlock( &trace->mutex );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_trace_end( const texpacker_in_data_t * const _data, const char * _name, uint64_t _begin, uint32_t _path, uint32_t _atlas )
+{
+    texpacker_trace_span( _data, _name, _begin, _path, _atlas, 0, 0 );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_trace_save( const texpacker_in_data_t * const _data )
+{
+    texpacker_trace_t * trace = _data->trace;
+
+    texpacker_mutex_lock( &trace->mutex );
+
+    json_t * j_events = json_array();
+
+    for( uint32_t index = 0; index != trace->threads_count; ++index )
+    {
+        char thread_name[32];
+
+        if( index == 0 )
+        {
+            strcpy( thread_name, "main" );
+        }
+        else
+        {
+            sprintf( thread_name, "worker %u", index );
+        }
+
+        json_t * j_name_args = json_object();
+        json_object_set_new( j_name_args, "name", json_string( thread_name ) );
+
+        json_t * j_name = json_object();
+        json_object_set_new( j_name, "name", json_string( "thread_name" ) );
+        json_object_set_new( j_name, "ph", json_string( "M" ) );
+        json_object_set_new( j_name, "pid", json_integer( 1 ) );
+        json_object_set_new( j_name, "tid", json_integer( index ) );
+        json_object_set_new( j_name, "args", j_name_args );
+
+        json_array_append_new( j_events, j_name );
+    }
+
+    for( uint32_t index = 0; index != trace->events_count; ++index )
+    {
+        const texpacker_trace_event_t * event = trace->events + index;
+
+        json_t * j_args = json_object();
+
+        if( event->path != TEXPACKER_TRACE_NONE )
+        {
+            json_object_set_new( j_args, "path", json_string( texpacker_get_string( _data, event->path ) ) );
+        }
+
+        if( event->atlas != TEXPACKER_TRACE_NONE )
+        {
+            json_object_set_new( j_args, "atlas", json_integer( event->atlas ) );
+        }
+
+        if( event->width != 0 )
+        {
+            json_object_set_new( j_args, "width", json_integer( event->width ) );
+            json_object_set_new( j_args, "height", json_integer( event->height ) );
+        }
+
+        json_t * j_event = json_object();
+        json_object_set_new( j_event, "name", json_string( event->name ) );
+        json_object_set_new( j_event, "cat", json_string( "texpacker" ) );
+        json_object_set_new( j_event, "ph", json_string( "X" ) );
+        json_object_set_new( j_event, "ts", json_integer( (json_int_t)event->begin ) );
+        json_object_set_new( j_event, "dur", json_integer( (json_int_t)event->duration ) );
+        json_object_set_new( j_event, "pid", json_integer( 1 ) );
+        json_object_set_new( j_event, "tid", json_integer( event->thread ) );
+        json_object_set_new( j_event, "args", j_args );
+
+        json_array_append_new( j_events, j_event );
+    }
+
+    texpacker_mutex_unlock( &trace->mutex );
+
+    json_t * j = json_object();
+    json_object_set_new( j, "traceEvents", j_events );
+    json_object_set_new( j, "displayTimeUnit", json_string( "ms" ) );
+
+    FILE * f = _wfopen( trace->path, L"wb" );
+
+    if( f == NULL )
+    {
+        json_decref( j );
+
+        return 1;
+    }
+
+    int res = json_dumpf( j, f, JSON_COMPACT );
+
+    json_decref( j );
+
+    fclose( f );
+
+    if( res != 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_decode_image_pixels( const texpacker_in_data_t * const _data, json_t * _cache_index, void * _buffer, size_t _len, void ** const _pixels, uint32_t * const _width, uint32_t * const _height, uint32_t * const _channel, uint32_t * const _cache_hits, uint32_t * const _cache_unwritten )
+{
+    char cache_key[17];
+    wchar_t cache_path[FILENAME_MAX];
+
+    if( _cache_index != NULL )
+    {
+        uint64_t hash = texpacker_cache_hash( _buffer, _len );
+
+        snprintf( cache_key, sizeof( cache_key ), "%016llx", (unsigned long long)hash );
+
+        texpacker_cache_make_path( _data, cache_key, cache_path );
+
+        void * pixels;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channel;
+        if( texpacker_cache_load_pixels( cache_path, &pixels, &width, &height, &channel ) == 0 )
+        {
+            free( _buffer );
+
+            *_pixels = pixels;
+            *_width = width;
+            *_height = height;
+            *_channel = channel;
+
+            size_t size = sizeof( texpacker_cache_header_t ) + (size_t)width * height * channel;
+            texpacker_cache_touch( _cache_index, cache_key, (json_int_t)size );
+
+            *_cache_hits += 1;
+
+            return 0;
+        }
+    }
+
+    int width;
+    int height;
+    int channel;
+    stbi_uc * image_pixels = stbi_load_from_memory( (stbi_uc *)_buffer, _len, &width, &height, &channel, 0 );
+
+    free( _buffer );
+
+    if( image_pixels == NULL )
+    {
+        return 1;
+    }
+
+    *_pixels = (void *)image_pixels;
+    *_width = (uint32_t)width;
+    *_height = (uint32_t)height;
+    *_channel = (uint32_t)channel;
+
+    //the cache keeps whole decoded images, trimming happens after
+    if( _cache_index != NULL )
+    {
+        size_t size;
+        if( texpacker_cache_save_pixels( cache_path, image_pixels, (uint32_t)width, (uint32_t)height, (uint32_t)channel, &size ) == 0 )
+        {
+            texpacker_cache_touch( _cache_index, cache_key, (json_int_t)size );
+        }
+        else
+        {
+            *_cache_unwritten += 1;
+        }
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_decode_texture_pixels( const texpacker_in_data_t * const _data, json_t * _cache_index, texpacker_texture_t * const _texture, void * _buffer, size_t _len, uint32_t * const _cache_hits, uint32_t * const _cache_unwritten )
+{
+    uint64_t trace_begin = texpacker_trace_begin( _data );
+
+    if( texpacker_decode_image_pixels( _data, _cache_index, _buffer, _len, &_texture->pixels, &_texture->width, &_texture->height, &_texture->channel, _cache_hits, _cache_unwritten ) != 0 )
+    {
+        return 1;
+    }
+
+    _texture->pixel_step = _texture->channel;
+    _texture->row_step = _texture->width * _texture->channel;
+
+    texpacker_finish_texture_pixels( _data, _texture );
+
+    texpacker_trace_end( _data, "decode", trace_begin, _texture->path, TEXPACKER_TRACE_NONE );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_sheet_pixels( const texpacker_in_data_t * const _data, json_t * _cache_index, texpacker_sheet_t * const _sheet, void ** const _pixels, uint32_t * const _cache_hits, uint32_t * const _cache_unwritten )
+{
+    const char * path = texpacker_get_string( _data, _sheet->path );
+
+    wchar_t sheet_path[FILENAME_MAX];
+    if( texpacker_utf8_to_wchar( path, strlen( path ), sheet_path, FILENAME_MAX ) != 0 )
+    {
+        return 1;
+    }
+
+    uint64_t read_begin = texpacker_trace_begin( _data );
+
+    void * sheet_buffer;
+    size_t sheet_len;
+    if( texpacker_load_data_buffer( sheet_path, &sheet_buffer, &sheet_len ) != 0 )
+    {
+        return 1;
+    }
+
+    texpacker_trace_end( _data, "read", read_begin, _sheet->path, TEXPACKER_TRACE_NONE );
+
+    uint64_t decode_begin = texpacker_trace_begin( _data );
+
+    if( texpacker_decode_image_pixels( _data, _cache_index, sheet_buffer, sheet_len, _pixels, &_sheet->width, &_sheet->height, &_sheet->channel, _cache_hits, _cache_unwritten ) != 0 )
+    {
+        return 1;
+    }
+
+    texpacker_trace_end( _data, "decode", decode_begin, _sheet->path, TEXPACKER_TRACE_NONE );
+
+    printf( "sheet: %s w %ux%u [%u]\n", path, _sheet->width, _sheet->height, _sheet->channel );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_view_sheet_texture( const texpacker_in_data_t * const _data, texpacker_texture_t * const _texture )
+{
+    const texpacker_sheet_t * sheet = _data->sheets + _texture->sheet;
+
+    if( sheet->pixels == NULL )
+    {
+        return 1;
+    }
+
+    uint32_t rect_w = _texture->sheet_rotate == 0 ? _texture->sheet_width : _texture->sheet_height;
+    uint32_t rect_h = _texture->sheet_rotate == 0 ? _texture->sheet_height : _texture->sheet_width;
+
+    if( _texture->sheet_x > sheet->width || rect_w > sheet->width - _texture->sheet_x || _texture->sheet_y > sheet->height || rect_h > sheet->height - _texture->sheet_y )
+    {
+        printf( "sheet: rect of %s outside %s\n", texpacker_get_string( _data, _texture->path ), texpacker_get_string( _data, sheet->path ) );
+
+        return 1;
+    }
+
+    uint64_t trace_begin = texpacker_trace_begin( _data );
+
+    uint32_t channel = sheet->channel;
+    uint32_t sheet_row_step = sheet->width * channel;
+
+    //the texture is a view into the sheet, a rotated rect is walked down its columns
+    _texture->pixels = (uint8_t *)sheet->pixels + (size_t)_texture->sheet_y * sheet_row_step + (size_t)_texture->sheet_x * channel;
+    _texture->width = _texture->sheet_width;
+    _texture->height = _texture->sheet_height;
+    _texture->channel = channel;
+    _texture->pixel_step = _texture->sheet_rotate == 0 ? channel : sheet_row_step;
+    _texture->row_step = _texture->sheet_rotate == 0 ? sheet_row_step : channel;
+
+    texpacker_finish_texture_pixels( _data, _texture );
+
+    texpacker_trace_end( _data, "view", trace_begin, _texture->path, TEXPACKER_TRACE_NONE );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_texture_pixels( const texpacker_in_data_t * const _data, json_t * _cache_index, texpacker_texture_t * const _texture, uint32_t * const _cache_hits, uint32_t * const _cache_unwritten )
+{
+    if( _texture->sheet != TEXPACKER_SHEET_NONE )
+    {
+        return texpacker_view_sheet_texture( _data, _texture );
+    }
+
+    uint64_t trace_begin = texpacker_trace_begin( _data );
+
+    void * texure_buffer;
+    size_t texure_len;
+    if( texpacker_load_texture_buffer( _data, _texture, &texure_buffer, &texure_len ) != 0 )
+    {
+        return 1;
+    }
+
+    texpacker_trace_end( _data, "read", trace_begin, _texture->path, TEXPACKER_TRACE_NONE );
+
+    if( texpacker_decode_texture_pixels( _data, _cache_index, _texture, texure_buffer, texure_len, _cache_hits, _cache_unwritten ) != 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_PARALLEL_MAX_JOBS 64
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_run_parallel( texpacker_thread_proc_t _proc, void * _jobs, size_t _job_size, uint32_t _jobs_count )
+{
+    //job 0 runs on the calling thread, a job whose thread fails to start runs inline after
+    texpacker_thread_t threads[TEXPACKER_PARALLEL_MAX_JOBS];
+    texpacker_thread_desc_t descs[TEXPACKER_PARALLEL_MAX_JOBS];
+    uint8_t started[TEXPACKER_PARALLEL_MAX_JOBS];
+
+    uint8_t * jobs = (uint8_t *)_jobs;
+
+    for( uint32_t index = 1; index < _jobs_count; ++index )
+    {
+        descs[index].proc = _proc;
+        descs[index].ud = jobs + index * _job_size;
+
+        started[index] = texpacker_thread_start( threads + index, descs + index ) == 0 ? 1 : 0;
+    }
+
+    _proc( jobs + 0 );
+
+    for( uint32_t index = 1; index < _jobs_count; ++index )
+    {
+        if( started[index] == 1 )
+        {
+            texpacker_thread_join( threads[index] );
+        }
+        else
+        {
+            _proc( jobs + index * _job_size );
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+typedef enum texpacker_read_state_e
+{
+    TEXPACKER_READ_STATE_PENDING,
+    TEXPACKER_READ_STATE_DONE,
+    TEXPACKER_READ_STATE_FAILED,
+} texpacker_read_state_e;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_read_slot_t
+{
+    void * buffer;
+    size_t len;
+
+    texpacker_read_state_e state;
+} texpacker_read_slot_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_reader_t
+{
+    const texpacker_in_data_t * data;
+
+    uint32_t next;
+    uint32_t consumed;
+    uint32_t stop;
+
+    uint32_t slots_count;
+    texpacker_read_slot_t * slots;
+
+    uint32_t threads_count;
+    texpacker_thread_t * threads;
+    texpacker_thread_desc_t thread_desc;
+
+    texpacker_mutex_t mutex;
+    texpacker_cond_t cond;
+} texpacker_reader_t;
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_reader_worker( void * _ud )
+{
+    texpacker_reader_t * reader = (texpacker_reader_t *)_ud;
+
+    uint32_t textures_count = reader->data->textures_count;
+
+    texpacker_mutex_lock( &reader->mutex );
+
+    for( ;; )
+    {
+        //a texture is only read ahead while its ring slot has been handed to the decoder
+        while( reader->stop == 0 && reader->next != textures_count && reader->next - reader->consumed >= reader->slots_count )
+        {
+            texpacker_cond_wait( &reader->cond, &reader->mutex );
+        }
+
+        if( reader->stop == 1 || reader->next == textures_count )
+        {
+            break;
+        }
+
+        uint32_t index = reader->next++;
+
+        texpacker_mutex_unlock( &reader->mutex );
+
+        void * buffer = NULL;
+        size_t len = 0;
+        int res = 0;
+
+        //sheet textures have no file of their own, their slot just passes through
+        if( reader->data->textures[index].sheet == TEXPACKER_SHEET_NONE )
+        {
+            uint64_t trace_begin = texpacker_trace_begin( reader->data );
+
+            res = texpacker_load_texture_buffer( reader->data, reader->data->textures + index, &buffer, &len );
+
+            texpacker_trace_end( reader->data, "read", trace_begin, reader->data->textures[index].path, TEXPACKER_TRACE_NONE );
+        }
+
+        texpacker_mutex_lock( &reader->mutex );
+
+        texpacker_read_slot_t * slot = reader->slots + index % reader->slots_count;
+
+        slot->buffer = buffer;
+        slot->len = len;
+        slot->state = res == 0 ? TEXPACKER_READ_STATE_DONE : TEXPACKER_READ_STATE_FAILED;
+
+        texpacker_cond_broadcast( &reader->cond );
+    }
+
+    texpacker_mutex_unlock( &reader->mutex );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_reader_start( texpacker_reader_t * const _reader, const texpacker_in_data_t * const _data )
+{
+    _reader->data = _data;
+    _reader->next = 0;
+    _reader->consumed = 0;
+    _reader->stop = 0;
+
+    //more threads or slots than textures only idle, and the thread count shares the parallel job cap
+    uint32_t threads_count = _data->io_threads > TEXPACKER_PARALLEL_MAX_JOBS ? TEXPACKER_PARALLEL_MAX_JOBS : _data->io_threads;
+    threads_count = threads_count > _data->textures_count ? _data->textures_count : threads_count;
+
+    uint32_t slots_count = _data->io_queue_depth > _data->textures_count ? _data->textures_count : _data->io_queue_depth;
+
+    _reader->slots_count = slots_count;
+    _reader->slots = TEXPACKER_NEWN( texpacker_read_slot_t, slots_count );
+
+    if( _reader->slots == NULL )
+    {
+        return 1;
+    }
+
+    for( uint32_t index = 0; index != _reader->slots_count; ++index )
+    {
+        texpacker_read_slot_t * slot = _reader->slots + index;
+
+        slot->buffer = NULL;
+        slot->len = 0;
+        slot->state = TEXPACKER_READ_STATE_PENDING;
+    }
+
+    _reader->threads_count = 0;
+    _reader->threads = TEXPACKER_NEWN( texpacker_thread_t, threads_count );
+
+    if( _reader->threads == NULL )
+    {
+        free( _reader->slots );
+
+        return 1;
+    }
+
+    _reader->thread_desc.proc = &texpacker_reader_worker;
+    _reader->thread_desc.ud = _reader;
+
+    texpacker_mutex_init( &_reader->mutex );
+    texpacker_cond_init( &_reader->cond );
+
+    for( uint32_t index = 0; index != threads_count; ++index )
+    {
+        if( texpacker_thread_start( _reader->threads + _reader->threads_count, &_reader->thread_desc ) != 0 )
+        {
+            break;
+        }
+
+        ++_reader->threads_count;
+    }
+
+    if( _reader->threads_count == 0 )
+    {
+        texpacker_cond_destroy( &_reader->cond );
+        texpacker_mutex_destroy( &_reader->mutex );
+
+        free( _reader->threads );
+        free( _reader->slots );
+
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_reader_take( texpacker_reader_t * const _reader, uint32_t _index, void ** const _buffer, size_t * const _len )
+{
+    texpacker_mutex_lock( &_reader->mutex );
+
+    texpacker_read_slot_t * slot = _reader->slots + _index % _reader->slots_count;
+
+    while( slot->state == TEXPACKER_READ_STATE_PENDING )
+    {
+        texpacker_cond_wait( &_reader->cond, &_reader->mutex );
+    }
+
+    int res = slot->state == TEXPACKER_READ_STATE_DONE ? 0 : 1;
+
+    *_buffer = slot->buffer;
+    *_len = slot->len;
+
+    slot->buffer = NULL;
+    slot->len = 0;
+    slot->state = TEXPACKER_READ_STATE_PENDING;
+
+    _reader->consumed = _index + 1;
+
+    texpacker_cond_broadcast( &_reader->cond );
+
+    texpacker_mutex_unlock( &_reader->mutex );
+
+    return res;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_reader_stop( texpacker_reader_t * const _reader )
+{
+    texpacker_mutex_lock( &_reader->mutex );
+
+    _reader->stop = 1;
+
+    texpacker_cond_broadcast( &_reader->cond );
+
+    texpacker_mutex_unlock( &_reader->mutex );
+
+    for( uint32_t index = 0; index != _reader->threads_count; ++index )
+    {
+        texpacker_thread_join( _reader->threads[index] );
+    }
+
+    for( uint32_t index = 0; index != _reader->slots_count; ++index )
+    {
+        free( _reader->slots[index].buffer );
+    }
+
+    texpacker_cond_destroy( &_reader->cond );
+    texpacker_mutex_destroy( &_reader->mutex );
+
+    free( _reader->threads );
+    free( _reader->slots );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_texures_pixels( texpacker_in_data_t * const _data )
+{
+    json_t * cache_index = NULL;
+
+    if( _data->cache_path != NULL )
+    {
+        //an unwritable cache is skipped for this run rather than failing the pack
+        if( _wmkdir( _data->cache_path ) != 0 && errno != EEXIST )
+        {
+            printf( "cache: unable to create %ls, cache disabled\n", _data->cache_path );
+        }
+        else
+        {
+            cache_index = texpacker_cache_load_index( _data );
+        }
+    }
+
+    uint32_t cache_hits = 0;
+    uint32_t cache_unwritten = 0;
+
+    //sheets are decoded once up front, their textures are views into them
+    for( uint32_t index = 0; index != _data->sheets_count; ++index )
+    {
+        texpacker_sheet_t * sheet = _data->sheets + index;
+
+        if( texpacker_load_sheet_pixels( _data, cache_index, sheet, &sheet->pixels, &cache_hits, &cache_unwritten ) != 0 )
+        {
+            printf( "sheet: unable to load %s\n", texpacker_get_string( _data, sheet->path ) );
+
+            json_decref( cache_index );
+
+            return 1;
+        }
+    }
+
+    uint32_t cache_lookups = _data->sheets_count;
+
+    //reader threads keep a window of files in flight while this thread decodes, in texture order
+    texpacker_reader_t reader;
+    uint32_t reader_started = 0;
+
+    if( _data->io_threads != 0 && _data->textures_count > 1 )
+    {
+        if( texpacker_reader_start( &reader, _data ) == 0 )
+        {
+            reader_started = 1;
+        }
+    }
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        texpacker_texture_t * texture = _data->textures + index;
+
+        int res;
+
+        if( reader_started == 1 )
+        {
+            void * texure_buffer;
+            size_t texure_len;
+            res = texpacker_reader_take( &reader, index, &texure_buffer, &texure_len );
+
+            if( res == 0 )
+            {
+                if( texture->sheet != TEXPACKER_SHEET_NONE )
+                {
+                    res = texpacker_view_sheet_texture( _data, texture );
+                }
+                else
+                {
+                    res = texpacker_decode_texture_pixels( _data, cache_index, texture, texure_buffer, texure_len, &cache_hits, &cache_unwritten );
+                }
+            }
+        }
+        else
+        {
+            res = texpacker_load_texture_pixels( _data, cache_index, texture, &cache_hits, &cache_unwritten );
+        }
+
+        if( res != 0 )
+        {
+            if( reader_started == 1 )
+            {
+                texpacker_reader_stop( &reader );
+            }
+
+            json_decref( cache_index );
+
+            return 1;
+        }
+
+        texture->atlas_rect = TEXPACKER_RECT_NONE;
+        texture->atlas = NULL;
+
+        if( texture->sheet == TEXPACKER_SHEET_NONE )
+        {
+            ++cache_lookups;
+        }
+
+        printf( "%s w %ux%u [%u]\n", texpacker_get_string( _data, texture->path ), texture->width, texture->height, texture->channel );
+    }
+
+    if( reader_started == 1 )
+    {
+        texpacker_reader_stop( &reader );
+    }
+
+    if( cache_index != NULL )
+    {
+        uint32_t cache_evicted = texpacker_cache_evict( _data, cache_index );
+
+        if( texpacker_cache_save_index( _data, cache_index ) != 0 || cache_unwritten != 0 )
+        {
+            printf( "cache: unable to write in %ls, %u images left uncached\n", _data->cache_path, cache_unwritten );
+        }
+
+        printf( "cache: %u hits %u misses %u evicted\n", cache_hits, cache_lookups - cache_hits, cache_evicted );
+
+        json_decref( cache_index );
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __max_uint32_t( uint32_t _a, uint32_t _b )
+{
+    return _a > _b ? _a : _b;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t __textures_key_width( uint32_t _width, uint32_t _height )
+{
+    (void)_height;
+
+    return _width;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t __textures_key_area( uint32_t _width, uint32_t _height )
+{
+    return (uint64_t)_width * _height;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t __textures_key_perimeter( uint32_t _width, uint32_t _height )
+{
+    return (uint64_t)_width + _height;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t __textures_key_max_side( uint32_t _width, uint32_t _height )
+{
+    return __max_uint32_t( _width, _height );
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t __textures_key_height( uint32_t _width, uint32_t _height )
+{
+    (void)_width;
+
+    return _height;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t __textures_key_width_height( uint32_t _width, uint32_t _height )
+{
+    return ((uint64_t)_width << 32) | _height;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_heuristic_t
+{
+    const char * name;
+
+    uint64_t (*key)(uint32_t _width, uint32_t _height);
+} texpacker_heuristic_t;
+//////////////////////////////////////////////////////////////////////////
+static const texpacker_heuristic_t texpacker_heuristics[] = {
+    {"width", &__textures_key_width},
+    {"area", &__textures_key_area},
+    {"perimeter", &__textures_key_perimeter},
+    {"max_side", &__textures_key_max_side},
+    {"height", &__textures_key_height},
+    {"width_height", &__textures_key_width_height}
+};
+//////////////////////////////////////////////////////////////////////////
+static int __sort_keys_compare_reverse( void const * _el1, void const * _el2 )
+{
+    const texpacker_sort_key_t * k1 = (const texpacker_sort_key_t *)_el1;
+    const texpacker_sort_key_t * k2 = (const texpacker_sort_key_t *)_el2;
+
+    if( k1->key != k2->key )
+    {
+        return k1->key < k2->key ? 1 : -1;
+    }
+
+    //ties keep the previous order, so chained sorts behave like a stable sort
+    return (k1->position > k2->position) - (k1->position < k2->position);
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_sort_pack_order( const texpacker_in_data_t * const _data, const texpacker_heuristic_t * _heuristic )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t textures_count = _data->textures_count;
+
+    for( uint32_t position = 0; position != textures_count; ++position )
+    {
+        uint32_t index = pack->order[position];
+
+        texpacker_sort_key_t * k = pack->keys + position;
+
+        k->key = _heuristic->key( pack->width[index], pack->height[index] );
+        k->index = index;
+        k->position = position;
+    }
+
+    qsort( pack->keys, textures_count, sizeof( texpacker_sort_key_t ), &__sort_keys_compare_reverse );
+
+    for( uint32_t position = 0; position != textures_count; ++position )
+    {
+        pack->order[position] = pack->keys[position].index;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_make_atlas_rect( texpacker_pack_state_t * const _pack, uint32_t _x, uint32_t _y, uint32_t _width, uint32_t _height )
+{
+    if( _pack->rects_count == _pack->rects_capacity )
+    {
+        _pack->rects_capacity = _pack->rects_capacity != 0 ? _pack->rects_capacity * 2 : 256;
+
+        _pack->rects = (texpacker_atlas_rect_t *)realloc( _pack->rects, _pack->rects_capacity * sizeof( texpacker_atlas_rect_t ) );
+    }
+
+    uint32_t index = _pack->rects_count++;
+
+    texpacker_atlas_rect_t * r = _pack->rects + index;
+
+    r->x = _x;
+    r->y = _y;
+    r->u = ~0U;
+    r->v = ~0U;
+    r->w = _width;
+    r->h = _height;
+
+    r->fit_w = _width;
+    r->fit_h = _height;
+
+    r->state = 0x00000000;
+    r->rotate = 0;
+
+    r->parent = TEXPACKER_RECT_NONE;
+
+    for( uint32_t l = 0; l != 4; ++l )
+    {
+        r->l[l] = TEXPACKER_RECT_NONE;
+    }
+
+    return index;
+}
+//////////////////////////////////////////////////////////////////////////
+static const texpacker_atlas_rect_t * texpacker_get_texture_rect( const texpacker_texture_t * _texture )
+{
+    return _texture->atlas->rects + _texture->atlas_rect;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_get_texture_footprint( const texpacker_in_data_t * const _data, const texpacker_texture_t * _t, uint32_t * const _width, uint32_t * const _height )
+{
+    uint32_t atlas_align = _data->atlas_align;
+
+    uint32_t w = _t->width + _data->atlas_border * 2;
+    uint32_t h = _t->height + _data->atlas_border * 2;
+
+    *_width = (w + atlas_align - 1) / atlas_align * atlas_align;
+    *_height = (h + atlas_align - 1) / atlas_align * atlas_align;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_fill_atlas_rect( const texpacker_in_data_t * const _data, uint32_t _r, int8_t _rotate, uint32_t _texture )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    texpacker_atlas_rect_t * r = pack->rects + _r;
+
+    if( r->state != 0x00000000 )
+    {
+        return 1;
+    }
+
+    uint32_t atlas_border = _data->atlas_border;
+
+    uint32_t tw = pack->width[_texture] + atlas_border * 2;
+    uint32_t th = pack->height[_texture] + atlas_border * 2;
+
+    uint32_t fw = pack->footprint_width[_texture];
+    uint32_t fh = pack->footprint_height[_texture];
+
+    if( _rotate == 0 )
+    {
+        r->u = tw;
+        r->v = th;
+    }
+    else
+    {
+        r->u = th;
+        r->v = tw;
+    }
+
+    r->state |= 0x00000001;
+    r->rotate = _rotate;
+
+    uint32_t x = r->x;
+    uint32_t y = r->y;
+
+    uint32_t u = _rotate == 0 ? fw : fh;
+    uint32_t v = _rotate == 0 ? fh : fw;
+
+    uint32_t w = r->w;
+    uint32_t h = r->h;
+
+    //the pool may grow here, so r is fetched again afterwards
+    uint32_t l[4];
+    l[0] = texpacker_make_atlas_rect( pack, x, y + v, w, h - v );
+    l[1] = texpacker_make_atlas_rect( pack, x + u, y, w - u, v );
+    l[2] = texpacker_make_atlas_rect( pack, x, y + v, u, h - v );
+    l[3] = texpacker_make_atlas_rect( pack, x + u, y, w - u, h );
+
+    r = pack->rects + _r;
+
+    for( uint32_t index = 0; index != 4; ++index )
+    {
+        r->l[index] = l[index];
+
+        pack->rects[l[index]].parent = _r;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_get_atlas_rect_range( const texpacker_atlas_rect_t * _r, uint32_t * const _begin, uint32_t * const _end )
+{
+    switch( _r->state & 0x00000F00 )
+    {
+    case 0x00000000:
+        {
+            *_begin = 0;
+            *_end = 4;
+        }break;
+    case 0x00000100:
+        {
+            *_begin = 0;
+            *_end = 2;
+        }break;
+    case 0x00000200:
+        {
+            *_begin = 2;
+            *_end = 4;
+        }break;
+    default:
+        {
+            *_begin = 0;
+            *_end = 0;
+        }break;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_update_atlas_rect_fit( texpacker_atlas_rect_t * _rects, uint32_t _r )
+{
+    for( uint32_t ri = _r; ri != TEXPACKER_RECT_NONE; ri = _rects[ri].parent )
+    {
+        texpacker_atlas_rect_t * r = _rects + ri;
+
+        uint32_t fit_w = 0;
+        uint32_t fit_h = 0;
+
+        switch( r->state & 0x0000000F )
+        {
+        case 0:
+            {
+                fit_w = r->w;
+                fit_h = r->h;
+            }break;
+        case 1:
+            {
+                uint32_t begin_index;
+                uint32_t end_index;
+                texpacker_get_atlas_rect_range( r, &begin_index, &end_index );
+
+                for( uint32_t index = begin_index; index != end_index; ++index )
+                {
+                    const texpacker_atlas_rect_t * rl = _rects + r->l[index];
+
+                    fit_w = rl->fit_w > fit_w ? rl->fit_w : fit_w;
+                    fit_h = rl->fit_h > fit_h ? rl->fit_h : fit_h;
+                }
+            }break;
+        default:
+            break;
+        }
+
+        r->fit_w = fit_w;
+        r->fit_h = fit_h;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_mark_atlas_rect( texpacker_atlas_rect_t * _rects, uint32_t _mr )
+{
+    uint32_t parent = _rects[_mr].parent;
+
+    if( parent == TEXPACKER_RECT_NONE )
+    {
+        return 0;
+    }
+
+    texpacker_atlas_rect_t * rp = _rects + parent;
+
+    const uint32_t masks[4] = {
+        (0x00000010 | 0x00000100),
+        (0x00000020 | 0x00000100),
+        (0x00000040 | 0x00000200),
+        (0x00000080 | 0x00000200)
+    };
+
+    for( uint32_t index = 0; index != 4; ++index )
+    {
+        if( rp->l[index] == _mr )
+        {
+            rp->state |= masks[index];
+
+            return 0;
+        }
+    }
+
+    return -1;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_atlas_rect_desc_t
+{
+    uint32_t r;
+    int8_t rotate;
+} texpacker_atlas_rect_desc_t;
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_find_atlas_rect( const texpacker_atlas_rect_t * _rects, uint32_t _r, uint32_t _w, uint32_t _h, int8_t _rotate_both, texpacker_atlas_rect_desc_t * const _best, uint32_t * const _density )
+{
+    const texpacker_atlas_rect_t * r = _rects + _r;
+
+    //fit_w/fit_h bound every free leaf below, so full subtrees are skipped whole
+    if( (r->fit_w < _w || r->fit_h < _h) && (r->fit_w < _h || r->fit_h < _w) )
+    {
+        return 0;
+    }
+
+    switch( r->state & 0x0000000F )
+    {
+    case 0:
+        {
+            //the rotated fit is only tried when upright does not fit, unless both are asked for
+            for( int8_t rotate = 0; rotate != 2; ++rotate )
+            {
+                uint32_t tw = rotate == 0 ? _w : _h;
+                uint32_t th = rotate == 0 ? _h : _w;
+
+                if( r->w < tw || r->h < th )
+                {
+                    continue;
+                }
+
+                uint32_t dw = r->w - tw;
+                uint32_t dh = r->h - th;
+                uint32_t dwh = dw * th + dh * tw + dw * dh;
+
+                if( dwh < *_density )
+                {
+                    *_density = dwh;
+
+                    _best->r = _r;
+                    _best->rotate = rotate;
+                }
+
+                if( _rotate_both == 0 )
+                {
+                    break;
+                }
+            }
+        }break;
+    case 1:
+        {
+            uint32_t begin_index;
+            uint32_t end_index;
+            texpacker_get_atlas_rect_range( r, &begin_index, &end_index );
+
+            for( uint32_t index = begin_index; index != end_index; ++index )
+            {
+                if( texpacker_find_atlas_rect( _rects, r->l[index], _w, _h, _rotate_both, _best, _density ) != 0 )
+                {
+                    return 1;
+                }
+            }
+        }break;
+    case 2:
+        {
+            //dummy
+
+            return 0;
+        }break;
+    default:
+        return 1;
+        break;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __new_pow2( uint32_t x )
+{
+    x--;
+    x |= x >> 1;
+    x |= x >> 2;
+    x |= x >> 4;
+    x |= x >> 8;
+    x |= x >> 16;
+    x++;
+
+    return x;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_align_atlas_size( const texpacker_in_data_t * const _data, uint32_t _size )
+{
+    if( _data->atlas_size_policy == TEXPACKER_SIZE_POLICY_POW2 )
+    {
+        return __new_pow2( _size );
+    }
+
+    uint32_t size_multiple = _data->atlas_size_multiple;
+
+    return (_size + size_multiple - 1) / size_multiple * size_multiple;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_prepare_pack_state( const texpacker_in_data_t * const _data )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t max_width = 0;
+    uint32_t max_height = 0;
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        const texpacker_texture_t * t = _data->textures + index;
+
+        uint32_t w;
+        uint32_t h;
+        texpacker_get_texture_footprint( _data, t, &w, &h );
+
+        //every build sorts from input order, so a watch repack matches a fresh run
+        pack->order[index] = index;
+
+        pack->width[index] = t->width;
+        pack->height[index] = t->height;
+        pack->footprint_width[index] = w;
+        pack->footprint_height[index] = h;
+        pack->group[index] = t->group;
+        pack->opaque[index] = t->opaque;
+
+        max_width = w > max_width ? w : max_width;
+        max_height = h > max_height ? h : max_height;
+    }
+
+    pack->bounds_width = texpacker_align_atlas_size( _data, max_width );
+    pack->bounds_height = texpacker_align_atlas_size( _data, max_height );
+
+    //a group shares one page, so one translucent member keeps the whole group on rgba
+    for( uint32_t group = 0; group != _data->groups_count; ++group )
+    {
+        pack->group_count[group] = 1;
+    }
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        uint32_t group = pack->group[index];
+
+        if( group != TEXPACKER_GROUP_NONE && pack->opaque[index] == 0 )
+        {
+            pack->group_count[group] = 0;
+        }
+    }
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        uint32_t group = pack->group[index];
+
+        if( group != TEXPACKER_GROUP_NONE && pack->group_count[group] == 0 )
+        {
+            pack->opaque[index] = 0;
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_fork_pack_state( const texpacker_pack_state_t * _pack, uint32_t _textures_count, texpacker_pack_state_t * const _fork )
+{
+    //sizes, footprints, groups and opacity are fixed once prepared, a fork only owns what a probe writes
+    *_fork = *_pack;
+
+    uint32_t fork_capacity = _textures_count + 1;
+
+    _fork->order = TEXPACKER_NEWN( uint32_t, fork_capacity );
+    _fork->keys = TEXPACKER_NEWN( texpacker_sort_key_t, fork_capacity );
+    _fork->placement = TEXPACKER_NEWN( uint32_t, fork_capacity );
+    _fork->page = TEXPACKER_NEWN( uint32_t, fork_capacity );
+    _fork->group_count = TEXPACKER_NEWN( uint32_t, fork_capacity );
+    _fork->group_cursor = TEXPACKER_NEWN( uint32_t, fork_capacity );
+    _fork->pending_count = 0;
+    _fork->pending = TEXPACKER_NEWN( uint32_t, fork_capacity );
+    _fork->rects_count = 0;
+    _fork->rects_capacity = 0;
+    _fork->rects = NULL;
+    _fork->undo_count = 0;
+    _fork->undo_capacity = 0;
+    _fork->undo = NULL;
+
+    memcpy( _fork->order, _pack->order, _textures_count * sizeof( uint32_t ) );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_release_fork_pack_state( texpacker_pack_state_t * const _fork )
+{
+    free( _fork->order );
+    free( _fork->keys );
+    free( _fork->placement );
+    free( _fork->page );
+    free( _fork->group_count );
+    free( _fork->group_cursor );
+    free( _fork->pending );
+    free( _fork->rects );
+    free( _fork->undo );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_promote_opaque_pending( texpacker_pack_state_t * _pack )
+{
+    if( _pack->pending_count != 0 || _pack->opaque_pending_count == 0 )
+    {
+        return;
+    }
+
+    memmove( _pack->pending, _pack->pending + _pack->opaque_pending_offset, _pack->opaque_pending_count * sizeof( uint32_t ) );
+
+    _pack->pending_count = _pack->opaque_pending_count;
+    _pack->opaque_pending_offset = 0;
+    _pack->opaque_pending_count = 0;
+    _pack->page_opaque = 1;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_reset_pack_state( const texpacker_in_data_t * const _data )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    pack->pending_count = 0;
+    pack->pages_count = 0;
+
+    //members of a group are made contiguous, starting where its first member sorts
+    for( uint32_t group = 0; group != _data->groups_count; ++group )
+    {
+        pack->group_count[group] = 0;
+        pack->group_cursor[group] = ~0U;
+    }
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        uint32_t group = pack->group[index];
+
+        if( group != TEXPACKER_GROUP_NONE )
+        {
+            ++pack->group_count[group];
+        }
+    }
+
+    //translucent pages are packed first, opaque textures wait behind them until those drain
+    uint32_t passes = _data->atlas_opaque_pages == 1 ? 2 : 1;
+    uint32_t translucent_count = 0;
+
+    for( uint32_t pass = 0; pass != passes; ++pass )
+    {
+        for( uint32_t position = 0; position != _data->textures_count; ++position )
+        {
+            uint32_t index = pack->order[position];
+
+            if( passes == 2 && pack->opaque[index] != pass )
+            {
+                continue;
+            }
+
+            pack->placement[index] = TEXPACKER_RECT_NONE;
+            pack->page[index] = TEXPACKER_PAGE_NONE;
+
+            uint32_t group = pack->group[index];
+
+            if( group == TEXPACKER_GROUP_NONE )
+            {
+                pack->pending[pack->pending_count++] = index;
+
+                continue;
+            }
+
+            if( pack->group_cursor[group] == ~0U )
+            {
+                pack->group_cursor[group] = pack->pending_count;
+                pack->pending_count += pack->group_count[group];
+            }
+
+            pack->pending[pack->group_cursor[group]++] = index;
+        }
+
+        if( pass == 0 )
+        {
+            translucent_count = pack->pending_count;
+        }
+    }
+
+    pack->opaque_pending_offset = translucent_count;
+    pack->opaque_pending_count = pack->pending_count - translucent_count;
+    pack->pending_count = translucent_count;
+    pack->page_opaque = 0;
+
+    texpacker_promote_opaque_pending( pack );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_place_atlas_texture( const texpacker_in_data_t * const _data, uint32_t _root, uint32_t _index, uint32_t _undo, uint32_t * const _placed )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t w = pack->footprint_width[_index];
+    uint32_t h = pack->footprint_height[_index];
+
+    uint32_t density = ~0U;
+
+    texpacker_atlas_rect_desc_t df;
+    df.r = TEXPACKER_RECT_NONE;
+    df.rotate = 0;
+
+    int8_t rotate_both = _data->atlas_effort == TEXPACKER_EFFORT_MAX ? 1 : 0;
+
+    if( texpacker_find_atlas_rect( pack->rects, _root, w, h, rotate_both, &df, &density ) != 0 )
+    {
+        return 1;
+    }
+
+    if( df.r == TEXPACKER_RECT_NONE )
+    {
+        *_placed = 0;
+
+        return 0;
+    }
+
+    uint32_t rf = df.r;
+    int8_t rotatef = df.rotate;
+
+    if( _undo == 1 )
+    {
+        if( pack->undo_count == pack->undo_capacity )
+        {
+            pack->undo_capacity = pack->undo_capacity != 0 ? pack->undo_capacity * 2 : 64;
+
+            pack->undo = (texpacker_atlas_rect_undo_t *)realloc( pack->undo, pack->undo_capacity * sizeof( texpacker_atlas_rect_undo_t ) );
+        }
+
+        texpacker_atlas_rect_undo_t * u = pack->undo + pack->undo_count++;
+
+        u->texture = _index;
+        u->rect = rf;
+        u->r = pack->rects[rf];
+        u->parent = pack->rects[rf].parent;
+
+        if( u->parent != TEXPACKER_RECT_NONE )
+        {
+            u->p = pack->rects[u->parent];
+        }
+    }
+
+    if( texpacker_fill_atlas_rect( _data, rf, rotatef, _index ) != 0 )
+    {
+        return 1;
+    }
+
+    if( texpacker_mark_atlas_rect( pack->rects, rf ) != 0 )
+    {
+        return 1;
+    }
+
+    texpacker_update_atlas_rect_fit( pack->rects, rf );
+
+    pack->placement[_index] = rf;
+
+    *_placed = 1;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_undo_atlas_textures( const texpacker_in_data_t * const _data, uint32_t _undo_begin, uint32_t _rects_count )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    for( uint32_t undo = pack->undo_count; undo != _undo_begin; --undo )
+    {
+        const texpacker_atlas_rect_undo_t * u = pack->undo + undo - 1;
+
+        pack->rects[u->rect] = u->r;
+
+        if( u->parent != TEXPACKER_RECT_NONE )
+        {
+            pack->rects[u->parent] = u->p;
+        }
+
+        texpacker_update_atlas_rect_fit( pack->rects, u->rect );
+
+        pack->placement[u->texture] = TEXPACKER_RECT_NONE;
+    }
+
+    pack->undo_count = _undo_begin;
+    pack->rects_count = _rects_count;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_probe_atlas_group( const texpacker_in_data_t * const _data, uint32_t _root, uint32_t _begin, uint32_t _end, uint32_t _split, uint32_t * const _packaged, uint32_t * const _unpackaged )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t undo_begin = pack->undo_count;
+    uint32_t rects_count = pack->rects_count;
+
+    uint32_t count = _end - _begin;
+    uint32_t packaged = 0;
+
+    for( uint32_t pending = _begin; pending != _end; ++pending )
+    {
+        uint32_t placed;
+        if( texpacker_place_atlas_texture( _data, _root, pack->pending[pending], 1, &placed ) != 0 )
+        {
+            return 1;
+        }
+
+        if( placed == 0 )
+        {
+            break;
+        }
+
+        ++packaged;
+    }
+
+    if( packaged == count )
+    {
+        pack->undo_count = undo_begin;
+
+        *_packaged = count;
+        *_unpackaged = 0;
+
+        return 0;
+    }
+
+    texpacker_undo_atlas_textures( _data, undo_begin, rects_count );
+
+    //a group that misses an otherwise empty page never fits whole, so only then it is split
+    if( _split == 0 )
+    {
+        *_packaged = 0;
+        *_unpackaged = count;
+
+        return 0;
+    }
+
+    packaged = 0;
+
+    for( uint32_t pending = _begin; pending != _end; ++pending )
+    {
+        uint32_t placed;
+        if( texpacker_place_atlas_texture( _data, _root, pack->pending[pending], 0, &placed ) != 0 )
+        {
+            return 1;
+        }
+
+        packaged += placed;
+    }
+
+    *_packaged = packaged;
+    *_unpackaged = count - packaged;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_probe_atlas_rect( uint32_t _width, uint32_t _height, const texpacker_in_data_t * const _data, uint32_t * const _packaged, uint32_t * const _unpackaged )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t rect = texpacker_make_atlas_rect( pack, 0, 0, _width, _height );
+
+    uint32_t packaged = 0;
+    uint32_t unpackaged = 0;
+
+    //the tree only ever gets fuller, so a footprint covering the last rejected one cannot fit either
+    uint32_t reject_w = ~0U;
+    uint32_t reject_h = ~0U;
+
+    for( uint32_t pending = 0; pending != pack->pending_count; ++pending )
+    {
+        uint32_t index = pack->pending[pending];
+
+        if( pack->placement[index] != TEXPACKER_RECT_NONE )
+        {
+            continue;
+        }
+
+        uint32_t group = pack->group[index];
+
+        if( group != TEXPACKER_GROUP_NONE )
+        {
+            uint32_t group_end = pending + 1;
+
+            while( group_end != pack->pending_count && pack->group[pack->pending[group_end]] == group )
+            {
+                ++group_end;
+            }
+
+            uint32_t group_packaged;
+            uint32_t group_unpackaged;
+            if( texpacker_probe_atlas_group( _data, rect, pending, group_end, packaged == 0 ? 1 : 0, &group_packaged, &group_unpackaged ) != 0 )
+            {
+                return 1;
+            }
+
+            packaged += group_packaged;
+            unpackaged += group_unpackaged;
+
+            pending = group_end - 1;
+
+            continue;
+        }
+
+        uint32_t w = pack->footprint_width[index];
+        uint32_t h = pack->footprint_height[index];
+
+        if( w >= reject_w && h >= reject_h )
+        {
+            ++unpackaged;
+
+            continue;
+        }
+
+        uint32_t placed;
+        if( texpacker_place_atlas_texture( _data, rect, index, 0, &placed ) != 0 )
+        {
+            return 1;
+        }
+
+        if( placed == 0 )
+        {
+            reject_w = w;
+            reject_h = h;
+
+            ++unpackaged;
+
+            continue;
+        }
+
+        ++packaged;
+    }
+
+    *_packaged = packaged;
+    *_unpackaged = unpackaged;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint8_t __luminance( uint8_t _r, uint8_t _g, uint8_t _b )
+{
+    return (uint8_t)((_r * 77U + _g * 150U + _b * 29U + 128U) >> 8);
+}
+//////////////////////////////////////////////////////////////////////////
+typedef void (*texpacker_convert_row_t)(uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step);
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_1_1( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 1, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_1_2( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 2, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = 255;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_1_3( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 3, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[0];
+        _dst[2] = _src[0];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_1_4( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 4, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[0];
+        _dst[2] = _src[0];
+        _dst[3] = 255;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_2_1( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 1, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_2_2( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 2, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[1];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_2_3( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 3, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[0];
+        _dst[2] = _src[0];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_2_4( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 4, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[0];
+        _dst[2] = _src[0];
+        _dst[3] = _src[1];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_3_1( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 1, _src += _src_step )
+    {
+        _dst[0] = __luminance( _src[0], _src[1], _src[2] );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_3_2( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 2, _src += _src_step )
+    {
+        _dst[0] = __luminance( _src[0], _src[1], _src[2] );
+        _dst[1] = 255;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_3_3( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 3, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[1];
+        _dst[2] = _src[2];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_3_4( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 4, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[1];
+        _dst[2] = _src[2];
+        _dst[3] = 255;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_4_1( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 1, _src += _src_step )
+    {
+        _dst[0] = __luminance( _src[0], _src[1], _src[2] );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_4_2( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 2, _src += _src_step )
+    {
+        _dst[0] = __luminance( _src[0], _src[1], _src[2] );
+        _dst[1] = _src[3];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_4_3( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 3, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[1];
+        _dst[2] = _src[2];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_convert_row_4_4( uint8_t * _dst, const uint8_t * _src, uint32_t _count, uint32_t _src_step )
+{
+    for( uint32_t index = 0; index != _count; ++index, _dst += 4, _src += _src_step )
+    {
+        _dst[0] = _src[0];
+        _dst[1] = _src[1];
+        _dst[2] = _src[2];
+        _dst[3] = _src[3];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static const texpacker_convert_row_t texpacker_convert_rows[4][4] = {
+    {&texpacker_convert_row_1_1, &texpacker_convert_row_1_2, &texpacker_convert_row_1_3, &texpacker_convert_row_1_4},
+    {&texpacker_convert_row_2_1, &texpacker_convert_row_2_2, &texpacker_convert_row_2_3, &texpacker_convert_row_2_4},
+    {&texpacker_convert_row_3_1, &texpacker_convert_row_3_2, &texpacker_convert_row_3_3, &texpacker_convert_row_3_4},
+    {&texpacker_convert_row_4_1, &texpacker_convert_row_4_2, &texpacker_convert_row_4_3, &texpacker_convert_row_4_4}
+};
+//////////////////////////////////////////////////////////////////////////
+static uint8_t * texpacker_get_atlas_row( const texpacker_atlas_t * _atlas, uint32_t _y )
+{
+    if( _y < _atlas->pixels_y || _y >= _atlas->pixels_y + _atlas->pixels_height )
+    {
+        return NULL;
+    }
+
+    uint8_t * altas_pixels_byte = (uint8_t *)_atlas->pixels;
+
+    return altas_pixels_byte + (size_t)(_y - _atlas->pixels_y) * _atlas->width * _atlas->channel;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_fill_pixels( uint8_t * _dst, const uint8_t * _pixel, uint32_t _count, uint32_t _pixel_size )
+{
+    if( _count == 0 )
+    {
+        return;
+    }
+
+    memcpy( _dst, _pixel, _pixel_size );
+
+    uint32_t filled = 1;
+
+    while( filled != _count )
+    {
+        uint32_t copy = filled < _count - filled ? filled : _count - filled;
+
+        memcpy( _dst + filled * _pixel_size, _dst, copy * _pixel_size );
+
+        filled += copy;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_render_rect_border( texpacker_atlas_t * _atlas, uint32_t _x, uint32_t _y, uint32_t _w, uint32_t _h, uint8_t _r, uint8_t _g, uint8_t _b, uint8_t _a )
+{
+    uint32_t x = _x;
+    uint32_t y = _y;
+
+    uint32_t w = _w;
+    uint32_t h = _h;
+
+    uint32_t atlas_pixel_size = _atlas->channel;
+
+    uint8_t rgba[] = {_r, _g, _b, _a};
+
+    uint8_t pixel[4];
+    texpacker_convert_rows[3][atlas_pixel_size - 1]( pixel, rgba, 1, 4 );
+
+    for( uint32_t index = 0; index != h; ++index )
+    {
+        uint8_t * atlas_row = texpacker_get_atlas_row( _atlas, y + index );
+
+        if( atlas_row == NULL )
+        {
+            continue;
+        }
+
+        if( index == 0 || index == h - 1 )
+        {
+            texpacker_fill_pixels( atlas_row + x * atlas_pixel_size, pixel, w, atlas_pixel_size );
+        }
+        else
+        {
+            memcpy( atlas_row + x * atlas_pixel_size, pixel, atlas_pixel_size );
+            memcpy( atlas_row + (x + w - 1) * atlas_pixel_size, pixel, atlas_pixel_size );
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_render_atlas_border( uint32_t _border, texpacker_atlas_t * _atlas, const texpacker_texture_t * _texture, uint8_t _r, uint8_t _g, uint8_t _b, uint8_t _a )
+{
+    const texpacker_atlas_rect_t * atlas_rect = texpacker_get_texture_rect( _texture );
+
+    uint32_t x = atlas_rect->x + _border;
+    uint32_t y = atlas_rect->y + _border;
+
+    uint32_t w = atlas_rect->u - _border * 2;
+    uint32_t h = atlas_rect->v - _border * 2;
+
+    texpacker_render_rect_border( _atlas, x, y, w, h, _r, _g, _b, _a );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_render_atlas_texture( const texpacker_in_data_t * const _data, texpacker_atlas_t * _atlas, const texpacker_texture_t * _texture )
+{
+    uint32_t atlas_border = _data->atlas_border;
+    uint32_t atlas_pixel_size = _atlas->channel * sizeof( uint8_t );
+
+    const texpacker_atlas_rect_t * atlas_rect = texpacker_get_texture_rect( _texture );
+
+    uint32_t tw = _texture->width;
+    uint32_t th = _texture->height;
+
+    const uint8_t * texture_pixels_byte = (const uint8_t *)_texture->pixels;
+    uint32_t texture_pixel_size = _texture->channel * sizeof( uint8_t );
+    uint32_t texture_row_size = tw * texture_pixel_size;
+
+    //sheet views step through their sheet, owned pixels are packed rows
+    uint32_t texture_pixel_step = _texture->pixel_step;
+    uint32_t texture_row_step = _texture->row_step;
+
+    texpacker_convert_row_t convert_row = texpacker_convert_rows[texture_pixel_size - 1][atlas_pixel_size - 1];
+
+    uint32_t u = atlas_rect->rotate == 0 ? tw : th;
+    uint32_t v = atlas_rect->rotate == 0 ? th : tw;
+
+    uint32_t extrude = _data->atlas_border_mode == TEXPACKER_BORDER_MODE_EXTRUDE ? atlas_border : 0;
+
+    uint32_t row_begin = atlas_rect->y + atlas_border - extrude;
+    uint32_t row_end = atlas_rect->y + atlas_border + v + extrude;
+
+    if( row_begin < _atlas->pixels_y )
+    {
+        row_begin = _atlas->pixels_y;
+    }
+
+    if( row_end > _atlas->pixels_y + _atlas->pixels_height )
+    {
+        row_end = _atlas->pixels_y + _atlas->pixels_height;
+    }
+
+    for( uint32_t y = row_begin; y < row_end; ++y )
+    {
+        uint32_t v_index = y < atlas_rect->y + atlas_border ? 0 : y - (atlas_rect->y + atlas_border);
+
+        if( v_index >= v )
+        {
+            v_index = v - 1;
+        }
+
+        uint8_t * atlas_row = texpacker_get_atlas_row( _atlas, y ) + (atlas_rect->x + atlas_border) * atlas_pixel_size;
+
+        if( atlas_rect->rotate == 0 )
+        {
+            const uint8_t * texture_row = texture_pixels_byte + (size_t)v_index * texture_row_step;
+
+            if( atlas_pixel_size == texture_pixel_size && texture_pixel_step == texture_pixel_size )
+            {
+                memcpy( atlas_row, texture_row, texture_row_size );
+            }
+            else
+            {
+                convert_row( atlas_row, texture_row, u, texture_pixel_step );
+            }
+        }
+        else
+        {
+            const uint8_t * texture_column = texture_pixels_byte + (size_t)v_index * texture_pixel_step;
+
+            convert_row( atlas_row, texture_column, u, texture_row_step );
+        }
+
+        if( extrude != 0 )
+        {
+            texpacker_fill_pixels( atlas_row - extrude * atlas_pixel_size, atlas_row, extrude, atlas_pixel_size );
+            texpacker_fill_pixels( atlas_row + u * atlas_pixel_size, atlas_row + (u - 1) * atlas_pixel_size, extrude, atlas_pixel_size );
+        }
+    }
+
+    if( _data->atlas_debug_outline == 1 )
+    {
+        texpacker_render_atlas_border( atlas_border, _atlas, _texture, 255, 0, 0, 255 );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_claim_atlas_textures( const texpacker_in_data_t * const _data, texpacker_atlas_t * _atlas )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t page = pack->pages_count++;
+
+    if( _atlas != NULL )
+    {
+        _atlas->index = page;
+    }
+
+    uint32_t pending_count = 0;
+
+    for( uint32_t pending = 0; pending != pack->pending_count; ++pending )
+    {
+        uint32_t index = pack->pending[pending];
+
+        if( pack->placement[index] != TEXPACKER_RECT_NONE )
+        {
+            pack->page[index] = page;
+
+            //dry runs only touch the pack state, real atlases publish placements to the textures
+            if( _atlas != NULL )
+            {
+                texpacker_texture_t * texture = _data->textures + index;
+
+                texture->atlas = _atlas;
+                texture->atlas_rect = pack->placement[index];
+            }
+
+            continue;
+        }
+
+        pack->pending[pending_count++] = index;
+    }
+
+    pack->pending_count = pending_count;
+
+    texpacker_promote_opaque_pending( pack );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_render_atlas( const texpacker_in_data_t * const _data, texpacker_atlas_t * _atlas )
+{
+    const texpacker_pack_state_t * pack = _data->pack;
+
+    for( uint32_t texture_index = 0; texture_index != _data->textures_count; ++texture_index )
+    {
+        if( pack->page[texture_index] != _atlas->index )
+        {
+            continue;
+        }
+
+        const texpacker_texture_t * texture = _data->textures + texture_index;
+
+        texpacker_render_atlas_texture( _data, _atlas, texture );
+    }
+
+    if( _data->atlas_debug_outline == 1 )
+    {
+        texpacker_render_rect_border( _atlas, 0, 0, _atlas->width, _atlas->height, 255, 0, 0, 255 );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_correct_atlas_alpha_pixel( uint32_t _u, uint32_t _v, texpacker_atlas_t * _atlas, uint32_t * const _tc, uint32_t * const _count )
+{
+    uint32_t atlas_width = _atlas->width;
+
+    if( _u >= atlas_width )
+    {
+        return;
+    }
+
+    const uint8_t * atlas_row = texpacker_get_atlas_row( _atlas, _v );
+
+    if( atlas_row == NULL )
+    {
+        return;
+    }
+
+    uint32_t atlas_pixel_size = _atlas->channel * sizeof( uint8_t );
+    uint32_t atlas_alpha_offset = atlas_pixel_size - 1;
+
+    const uint8_t * atlas_pixel = atlas_row + _u * atlas_pixel_size;
+
+    uint32_t atlas_pixel_probe_a = atlas_pixel[atlas_alpha_offset];
+
+    if( atlas_pixel_probe_a == 0 )
+    {
+        return;
+    }
+
+    for( uint32_t index = 0; index != atlas_alpha_offset; ++index )
+    {
+        _tc[index] += atlas_pixel[index];
+    }
+
+    *_count += 1;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_correct_atlas_alpha_pixels( texpacker_atlas_t * _atlas, uint32_t _v_begin, uint32_t _v_end )
+{
+    uint32_t atlas_width = _atlas->width;
+    uint32_t atlas_pixel_size = _atlas->channel * sizeof( uint8_t );
+
+    if( atlas_pixel_size != 2 && atlas_pixel_size != 4 )
+    {
+        return;
+    }
+
+    uint32_t atlas_alpha_offset = atlas_pixel_size - 1;
+
+    for( uint32_t v = _v_begin; v != _v_end; ++v )
+    {
+        uint8_t * atlas_row = texpacker_get_atlas_row( _atlas, v );
+
+        for( uint32_t u = 0; u != atlas_width; ++u )
+        {
+            uint8_t * atlas_pixel = atlas_row + u * atlas_pixel_size;
+
+            uint32_t atlas_pixel_a = atlas_pixel[atlas_alpha_offset];
+
+            if( atlas_pixel_a != 0 )
+            {
+                continue;
+            }
+
+            uint32_t tc[3] = {0, 0, 0};
+
+            uint32_t count = 0;
+
+            texpacker_correct_atlas_alpha_pixel( u - 1, v - 1, _atlas, tc, &count );
+            texpacker_correct_atlas_alpha_pixel( u - 1, v + 0, _atlas, tc, &count );
+            texpacker_correct_atlas_alpha_pixel( u - 1, v + 1, _atlas, tc, &count );
+            texpacker_correct_atlas_alpha_pixel( u + 0, v - 1, _atlas, tc, &count );
+            texpacker_correct_atlas_alpha_pixel( u + 0, v + 1, _atlas, tc, &count );
+            texpacker_correct_atlas_alpha_pixel( u + 1, v - 1, _atlas, tc, &count );
+            texpacker_correct_atlas_alpha_pixel( u + 1, v + 0, _atlas, tc, &count );
+            texpacker_correct_atlas_alpha_pixel( u + 1, v + 1, _atlas, tc, &count );
+
+            if( count == 0 )
+            { 
+                continue;
+            }
+
+            for( uint32_t index = 0; index != atlas_alpha_offset; ++index )
+            {
+                atlas_pixel[index] = (uint8_t)(tc[index] / count);
+            }
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static uint64_t texpacker_get_time_ms( void )
+{
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_time_budget_exceeded( const texpacker_in_data_t * const _data )
+{
+    if( _data->atlas_time_budget == 0 )
+    {
+        return 0;
+    }
+
+    uint64_t time_elapsed = texpacker_get_time_ms() - _data->atlas_time_begin;
+
+    if( time_elapsed < (uint64_t)_data->atlas_time_budget )
+    {
+        return 0;
+    }
+
+    return 1;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_reprobe_atlas_rect( uint32_t _width, uint32_t _height, const texpacker_in_data_t * const _data, uint32_t * const _packaged, uint32_t * const _unpackaged )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    for( uint32_t pending = 0; pending != pack->pending_count; ++pending )
+    {
+        uint32_t index = pack->pending[pending];
+
+        pack->placement[index] = TEXPACKER_RECT_NONE;
+    }
+
+    //the pool is emptied for every probe, so the root is always rect 0
+    pack->rects_count = 0;
+
+    uint64_t trace_begin = texpacker_trace_begin( _data );
+
+    if( texpacker_probe_atlas_rect( _width, _height, _data, _packaged, _unpackaged ) != 0 )
+    {
+        return 1;
+    }
+
+    texpacker_trace_span( _data, "probe", trace_begin, TEXPACKER_TRACE_NONE, pack->pages_count, _width, _height );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_refine_atlas_size( const texpacker_in_data_t * const _data, uint32_t _base_width, uint32_t _base_height, uint32_t * const _packaged )
+{
+    const texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t size_multiple = _data->atlas_size_multiple;
+
+    uint32_t origin_width = pack->rects[0].w;
+    uint32_t origin_height = pack->rects[0].h;
+
+    uint32_t best_width = origin_width;
+    uint32_t best_height = origin_height;
+    uint64_t best_area = (uint64_t)origin_width * origin_height;
+
+    uint64_t textures_area = 0;
+
+    for( uint32_t pending = 0; pending != pack->pending_count; ++pending )
+    {
+        uint32_t index = pack->pending[pending];
+
+        textures_area += (uint64_t)pack->footprint_width[index] * pack->footprint_height[index];
+    }
+
+    uint32_t max_height = _data->atlas_max_height - _data->atlas_max_height % size_multiple;
+
+    uint32_t width_steps = (origin_width - _base_width) / size_multiple;
+    uint32_t width_stride = width_steps > 16 ? width_steps / 16 : 1;
+
+    uint32_t packaged;
+    uint32_t unpackaged;
+
+    for( uint32_t width_step = 0; width_step <= width_steps; width_step += width_stride )
+    {
+        if( width_step != 0 && texpacker_time_budget_exceeded( _data ) == 1 )
+        {
+            printf( "atlas size: time budget %u ms exceeded\n", _data->atlas_time_budget );
+
+            break;
+        }
+
+        uint32_t probe_width = _base_width + width_step * size_multiple;
+
+        uint64_t lower_height = (textures_area + probe_width - 1) / probe_width;
+
+        uint32_t low = (uint32_t)(lower_height > _base_height ? lower_height : _base_height);
+        low = texpacker_align_atlas_size( _data, low );
+
+        uint64_t upper_height = best_area / probe_width;
+        uint32_t high = upper_height < max_height ? (uint32_t)upper_height : max_height;
+        high -= high % size_multiple;
+
+        if( low > high )
+        {
+            continue;
+        }
+
+        uint32_t fit_height = 0;
+
+        while( low <= high )
+        {
+            uint32_t probe_height = low + ((high - low) / size_multiple / 2) * size_multiple;
+
+            if( texpacker_reprobe_atlas_rect( probe_width, probe_height, _data, &packaged, &unpackaged ) != 0 )
+            {
+                return 1;
+            }
+
+            if( unpackaged == 0 )
+            {
+                fit_height = probe_height;
+
+                if( probe_height < size_multiple )
+                {
+                    break;
+                }
+
+                high = probe_height - size_multiple;
+            }
+            else
+            {
+                low = probe_height + size_multiple;
+            }
+        }
+
+        if( fit_height == 0 )
+        {
+            continue;
+        }
+
+        uint64_t fit_area = (uint64_t)probe_width * fit_height;
+
+        if( fit_area < best_area )
+        {
+            best_width = probe_width;
+            best_height = fit_height;
+            best_area = fit_area;
+        }
+    }
+
+    if( best_width == origin_width && best_height == origin_height )
+    {
+        return texpacker_reprobe_atlas_rect( origin_width, origin_height, _data, _packaged, &unpackaged );
+    }
+
+    if( texpacker_reprobe_atlas_rect( best_width, best_height, _data, _packaged, &unpackaged ) != 0 )
+    {
+        return 1;
+    }
+
+    uint64_t origin_area = (uint64_t)origin_width * origin_height;
+
+    printf( "atlas size: %ux%u -> %ux%u saved %llu pixels\n", origin_width, origin_height, best_width, best_height, (unsigned long long)(origin_area - best_area) );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_layout_atlas( const texpacker_in_data_t * const _data, uint32_t * const _packaged, uint32_t * const _unpackaged )
+{
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t base_max_width = pack->bounds_width;
+    uint32_t base_max_height = pack->bounds_height;
+
+    if( base_max_width > _data->atlas_max_width || base_max_height > _data->atlas_max_height )
+    {
+        return 1;
+    }
+
+    pack->rects_count = 0;
+
+    uint32_t packaged = 0;
+    uint32_t unpackaged = 0;
+
+    //array layers all share the largest allowed size
+    if( _data->atlas_effort == TEXPACKER_EFFORT_FAST || _data->output_array_path != NULL )
+    {
+        uint32_t fast_width = base_max_width;
+        uint32_t fast_height = base_max_height;
+
+        if( _data->atlas_size_policy == TEXPACKER_SIZE_POLICY_POW2 )
+        {
+            while( (fast_width << 1) <= _data->atlas_max_width )
+            {
+                fast_width <<= 1;
+            }
+
+            while( (fast_height << 1) <= _data->atlas_max_height )
+            {
+                fast_height <<= 1;
+            }
+        }
+        else
+        {
+            fast_width = _data->atlas_max_width - _data->atlas_max_width % _data->atlas_size_multiple;
+            fast_height = _data->atlas_max_height - _data->atlas_max_height % _data->atlas_size_multiple;
+        }
+
+        if( texpacker_reprobe_atlas_rect( fast_width, fast_height, _data, &packaged, &unpackaged ) != 0 )
+        {
+            return 1;
+        }
+
+        *_packaged = packaged;
+        *_unpackaged = unpackaged;
+
+        return 0;
+    }
+
+    uint32_t probe_width[] = {0, 1, 0, 1, 2, 1, 2, 3, 2, 3, 4, 3, 4, 5, 4, 5, 6, 5, 6, 7, 6, 7, 8, 7, 8, 9, 8, 9, 10, 9, 10, 9};
+    uint32_t probe_height[] = {0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 10};
+
+    uint32_t last_atlas_width = 0;
+    uint32_t last_atlas_height = 0;
+
+    for( uint32_t atlas_probe = 0; atlas_probe != sizeof( probe_width ) / sizeof( uint32_t ); ++atlas_probe )
+    {
+        uint32_t probe_atlas_width = base_max_width << probe_width[atlas_probe];
+        uint32_t probe_atlas_height = base_max_height << probe_height[atlas_probe];
+
+        if( _data->atlas_size_policy != TEXPACKER_SIZE_POLICY_POW2 )
+        {
+            uint32_t max_width = _data->atlas_max_width - _data->atlas_max_width % _data->atlas_size_multiple;
+            uint32_t max_height = _data->atlas_max_height - _data->atlas_max_height % _data->atlas_size_multiple;
+
+            probe_atlas_width = probe_atlas_width < max_width ? probe_atlas_width : max_width;
+            probe_atlas_height = probe_atlas_height < max_height ? probe_atlas_height : max_height;
+        }
+
+        if( probe_atlas_width > _data->atlas_max_width || probe_atlas_height > _data->atlas_max_height )
+        {
+            continue;
+        }
+
+        if( probe_atlas_width == last_atlas_width && probe_atlas_height == last_atlas_height )
+        {
+            continue;
+        }
+
+        last_atlas_width = probe_atlas_width;
+        last_atlas_height = probe_atlas_height;
+
+        if( texpacker_reprobe_atlas_rect( probe_atlas_width, probe_atlas_height, _data, &packaged, &unpackaged ) != 0 )
+        {
+            return 1;
+        }
+
+        if( unpackaged == 0 )
+        {
+            break;
+        }
+    }
+
+    if( pack->rects_count == 0 )
+    {
+        return 1;
+    }
+
+    if( unpackaged == 0 && _data->atlas_size_policy != TEXPACKER_SIZE_POLICY_POW2 )
+    {
+        if( texpacker_refine_atlas_size( _data, base_max_width, base_max_height, &packaged ) != 0 )
+        {
+            return 1;
+        }
+    }
+
+    *_packaged = packaged;
+    *_unpackaged = unpackaged;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_crop_atlas( const texpacker_in_data_t * const _data, uint32_t * const _width, uint32_t * const _height )
+{
+    uint32_t used_width = 0;
+    uint32_t used_height = 0;
+
+    const texpacker_pack_state_t * pack = _data->pack;
+
+    for( uint32_t pending = 0; pending != pack->pending_count; ++pending )
+    {
+        uint32_t index = pack->pending[pending];
+
+        if( pack->placement[index] == TEXPACKER_RECT_NONE )
+        {
+            continue;
+        }
+
+        const texpacker_atlas_rect_t * r = pack->rects + pack->placement[index];
+
+        used_width = __max_uint32_t( used_width, r->x + r->u );
+        used_height = __max_uint32_t( used_height, r->y + r->v );
+    }
+
+    uint32_t atlas_align = _data->atlas_align;
+
+    used_width = (used_width + atlas_align - 1) / atlas_align * atlas_align;
+    used_height = (used_height + atlas_align - 1) / atlas_align * atlas_align;
+
+    uint32_t crop_width = texpacker_align_atlas_size( _data, used_width );
+    uint32_t crop_height = texpacker_align_atlas_size( _data, used_height );
+
+    if( crop_width >= *_width && crop_height >= *_height )
+    {
+        return;
+    }
+
+    crop_width = crop_width < *_width ? crop_width : *_width;
+    crop_height = crop_height < *_height ? crop_height : *_height;
+
+    printf( "atlas crop: %ux%u -> %ux%u\n", *_width, *_height, crop_width, crop_height );
+
+    *_width = crop_width;
+    *_height = crop_height;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_make_atlas( const texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlas, uint32_t * const _packaged, uint32_t * const _unpackaged )
+{
+    //load rejects an empty set, there is no page to hand back
+    if( _data->textures_count == 0 )
+    {
+        return 1;
+    }
+
+    texpacker_pack_state_t * pack = _data->pack;
+
+    uint64_t trace_begin = texpacker_trace_begin( _data );
+
+    uint32_t packaged;
+    uint32_t unpackaged;
+    if( texpacker_layout_atlas( _data, &packaged, &unpackaged ) != 0 )
+    {
+        return 1;
+    }
+
+    texpacker_trace_end( _data, "layout", trace_begin, TEXPACKER_TRACE_NONE, pack->pages_count );
+
+    //textures still waiting for opaque pages are unpackaged too
+    unpackaged += pack->opaque_pending_count;
+
+    texpacker_atlas_t * atlas = TEXPACKER_NEW( texpacker_atlas_t );
+
+    atlas->width = pack->rects[0].w;
+    atlas->height = pack->rects[0].h;
+    atlas->channel = pack->page_opaque == 1 ? _data->atlas_channels - 1 : _data->atlas_channels;
+    atlas->path = NULL;
+
+    atlas->palette.colors = 0;
+    atlas->palette.exact = 0;
+    atlas->palette.rmse = 0.0;
+    atlas->palette.max_error = 0;
+
+    if( (_data->atlas_crop == 1 || _data->atlas_effort == TEXPACKER_EFFORT_FAST) && _data->output_array_path == NULL )
+    {
+        texpacker_crop_atlas( _data, &atlas->width, &atlas->height );
+    }
+
+    texpacker_claim_atlas_textures( _data, atlas );
+
+    //the atlas takes the rect pool over, the next layout starts a fresh one
+    atlas->rects_count = pack->rects_count;
+    atlas->rects = pack->rects;
+
+    pack->rects_count = 0;
+    pack->rects_capacity = 0;
+    pack->rects = NULL;
+
+    if( _data->output_strip_height != 0 )
+    {
+        atlas->pixels = NULL;
+        atlas->pixels_y = 0;
+        atlas->pixels_height = 0;
+    }
+    else
+    {
+        uint32_t atlas_width = atlas->width;
+        uint32_t atlas_height = atlas->height;
+        uint32_t atlas_channel = atlas->channel;
+
+        size_t atlas_pixels_size = (size_t)atlas_width * atlas_height * atlas_channel * sizeof( uint8_t );
+        void * atlas_pixels = malloc( atlas_pixels_size );
+        memset( atlas_pixels, 0x00, atlas_pixels_size );
+
+        atlas->pixels = atlas_pixels;
+        atlas->pixels_y = 0;
+        atlas->pixels_height = atlas_height;
+
+        uint64_t render_begin = texpacker_trace_begin( _data );
+
+        texpacker_render_atlas( _data, atlas );
+
+        texpacker_trace_end( _data, "render", render_begin, TEXPACKER_TRACE_NONE, atlas->index );
+
+        uint64_t bleed_begin = texpacker_trace_begin( _data );
+
+        texpacker_correct_atlas_alpha_pixels( atlas, 0, atlas_height );
+
+        texpacker_trace_end( _data, "bleed", bleed_begin, TEXPACKER_TRACE_NONE, atlas->index );
+    }
+
+    *_atlas = atlas;
+    *_packaged = packaged;
+    *_unpackaged = unpackaged;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static const texpacker_in_data_t * texpacker_get_page_data( const texpacker_in_data_t * const _data, texpacker_in_data_t * const _tail_data )
+{
+    if( _data->atlas_tail_page == TEXPACKER_PAGE_NONE || _data->pack->pages_count < _data->atlas_tail_page )
+    {
+        return _data;
+    }
+
+    //the tail pages share the leftovers under their own, smaller cap
+    *_tail_data = *_data;
+
+    _tail_data->atlas_max_width = _data->atlas_tail_max_width;
+    _tail_data->atlas_max_height = _data->atlas_tail_max_height;
+
+    return _tail_data;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_probe_atlases( const texpacker_in_data_t * const _data, uint32_t * const _atlases_count, uint64_t * const _atlases_area )
+{
+    const texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t atlases_count = 0;
+    uint64_t atlases_area = 0;
+
+    texpacker_reset_pack_state( _data );
+
+    for( ;; )
+    {
+        texpacker_in_data_t tail_data;
+        const texpacker_in_data_t * page_data = texpacker_get_page_data( _data, &tail_data );
+
+        uint32_t packaged;
+        uint32_t unpackaged;
+        if( texpacker_layout_atlas( page_data, &packaged, &unpackaged ) != 0 )
+        {
+            return 1;
+        }
+
+        unpackaged += pack->opaque_pending_count;
+
+        texpacker_claim_atlas_textures( _data, NULL );
+
+        ++atlases_count;
+        atlases_area += (uint64_t)pack->rects[0].w * pack->rects[0].h;
+
+        if( unpackaged == 0 )
+        {
+            break;
+        }
+
+        if( packaged == 0 )
+        {
+            return 1;
+        }
+    }
+
+    *_atlases_count = atlases_count;
+    *_atlases_area = atlases_area;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_LOCAL_SEARCH_TRIES 64
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_local_search_textures( texpacker_in_data_t * const _data, uint32_t _atlases_count, uint64_t _atlases_area )
+{
+    uint32_t best_atlases_count = _atlases_count;
+    uint64_t best_atlases_area = _atlases_area;
+
+    uint32_t tries = 0;
+    uint32_t improvements = 0;
+
+    texpacker_pack_state_t * pack = _data->pack;
+
+    for( uint32_t index = 0; index + 1 < _data->textures_count && tries != TEXPACKER_LOCAL_SEARCH_TRIES; ++index )
+    {
+        uint32_t * t0 = pack->order + index;
+        uint32_t * t1 = pack->order + index + 1;
+
+        if( pack->width[*t0] == pack->width[*t1] && pack->height[*t0] == pack->height[*t1] )
+        {
+            continue;
+        }
+
+        if( texpacker_time_budget_exceeded( _data ) == 1 )
+        {
+            printf( "local search: time budget %u ms exceeded\n", _data->atlas_time_budget );
+
+            break;
+        }
+
+        ++tries;
+
+        uint32_t swap = *t0;
+        *t0 = *t1;
+        *t1 = swap;
+
+        uint32_t atlases_count;
+        uint64_t atlases_area;
+        if( texpacker_probe_atlases( _data, &atlases_count, &atlases_area ) != 0 )
+        {
+            return 1;
+        }
+
+        if( atlases_count < best_atlases_count || (atlases_count == best_atlases_count && atlases_area < best_atlases_area) )
+        {
+            best_atlases_count = atlases_count;
+            best_atlases_area = atlases_area;
+
+            ++improvements;
+
+            printf( "local search: swap %u atlases %u area %llu\n", index, atlases_count, (unsigned long long)atlases_area );
+
+            continue;
+        }
+
+        swap = *t0;
+        *t0 = *t1;
+        *t1 = swap;
+    }
+
+    printf( "local search: %u tries %u improvements atlases %u area %llu\n", tries, improvements, best_atlases_count, (unsigned long long)best_atlases_area );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_heuristic_job_t
+{
+    const texpacker_in_data_t * data;
+    uint32_t index;
+    texpacker_pack_state_t pack;
+    uint32_t skipped;
+    uint32_t atlases_count;
+    uint64_t atlases_area;
+    int result;
+} texpacker_heuristic_job_t;
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_heuristic_worker( void * _ud )
+{
+    texpacker_heuristic_job_t * job = (texpacker_heuristic_job_t *)_ud;
+
+    job->skipped = 0;
+    job->result = 0;
+
+    if( job->index != 0 && texpacker_time_budget_exceeded( job->data ) == 1 )
+    {
+        job->skipped = 1;
+
+        return;
+    }
+
+    texpacker_in_data_t job_data = *job->data;
+    job_data.pack = &job->pack;
+
+    const texpacker_heuristic_t * heuristic = texpacker_heuristics + job->index;
+
+    uint64_t trace_begin = texpacker_trace_begin( &job_data );
+
+    //sorts chain, ties keep the order the heuristics before this one left
+    for( uint32_t index = 0; index <= job->index; ++index )
+    {
+        texpacker_sort_pack_order( &job_data, texpacker_heuristics + index );
+    }
+
+    job->result = texpacker_probe_atlases( &job_data, &job->atlases_count, &job->atlases_area );
+
+    texpacker_trace_end( &job_data, heuristic->name, trace_begin, TEXPACKER_TRACE_NONE, TEXPACKER_TRACE_NONE );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_load_texures_sort( texpacker_in_data_t * const _data )
+{
+    uint32_t heuristics_count = sizeof( texpacker_heuristics ) / sizeof( texpacker_heuristic_t );
+
+    uint32_t heuristics_tries = _data->atlas_heuristics;
+
+    if( heuristics_tries == 0 || heuristics_tries > heuristics_count )
+    {
+        heuristics_tries = heuristics_count;
+    }
+
+    if( heuristics_tries == 1 || _data->textures_count == 0 )
+    {
+        texpacker_sort_pack_order( _data, texpacker_heuristics + 0 );
+
+        return 0;
+    }
+
+    //each ordering is probed on its own fork of the pack state, so they run side by side
+    texpacker_heuristic_job_t jobs[sizeof( texpacker_heuristics ) / sizeof( texpacker_heuristic_t )];
+
+    for( uint32_t index = 0; index != heuristics_tries; ++index )
+    {
+        texpacker_heuristic_job_t * job = jobs + index;
+
+        job->data = _data;
+        job->index = index;
+
+        texpacker_fork_pack_state( _data->pack, _data->textures_count, &job->pack );
+    }
+
+    texpacker_run_parallel( &texpacker_heuristic_worker, jobs, sizeof( texpacker_heuristic_job_t ), heuristics_tries );
+
+    uint32_t best_index = ~0U;
+    uint32_t best_atlases_count = ~0U;
+    uint64_t best_atlases_area = ~0ULL;
+    uint32_t skipped_count = 0;
+
+    int res = 0;
+
+    for( uint32_t index = 0; index != heuristics_tries; ++index )
+    {
+        const texpacker_heuristic_job_t * job = jobs + index;
+
+        if( job->skipped == 1 )
+        {
+            ++skipped_count;
+
+            continue;
+        }
+
+        if( job->result != 0 )
+        {
+            res = 1;
+
+            continue;
+        }
+
+        const texpacker_heuristic_t * heuristic = texpacker_heuristics + index;
+
+        printf( "heuristic: %s atlases %u area %llu\n", heuristic->name, job->atlases_count, (unsigned long long)job->atlases_area );
+
+        if( job->atlases_count < best_atlases_count || (job->atlases_count == best_atlases_count && job->atlases_area < best_atlases_area) )
+        {
+            best_index = index;
+            best_atlases_count = job->atlases_count;
+            best_atlases_area = job->atlases_area;
+        }
+    }
+
+    if( skipped_count != 0 )
+    {
+        printf( "heuristic: time budget %u ms exceeded, skip %u heuristics\n", _data->atlas_time_budget, skipped_count );
+    }
+
+    if( res == 0 )
+    {
+        const texpacker_heuristic_t * best_heuristic = texpacker_heuristics + best_index;
+
+        printf( "heuristic: best %s atlases %u area %llu\n", best_heuristic->name, best_atlases_count, (unsigned long long)best_atlases_area );
+
+        memcpy( _data->pack->order, jobs[best_index].pack.order, _data->textures_count * sizeof( uint32_t ) );
+    }
+
+    for( uint32_t index = 0; index != heuristics_tries; ++index )
+    {
+        texpacker_release_fork_pack_state( &jobs[index].pack );
+    }
+
+    if( res != 0 )
+    {
+        return 1;
+    }
+
+    if( _data->atlas_effort == TEXPACKER_EFFORT_MAX )
+    {
+        if( texpacker_local_search_textures( _data, best_atlases_count, best_atlases_area ) != 0 )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_double_cap( uint32_t _cap )
+{
+    //zero ends a cap search instead of wrapping around
+    return _cap > 0x7FFFFFFFU ? 0 : _cap << 1;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_balance_tail_atlases( texpacker_in_data_t * const _data, uint32_t _atlases_count, uint64_t _atlases_area )
+{
+    //array layers share one size, and a single page has no leftovers to share
+    if( _atlases_count < 2 || _data->output_array_path != NULL )
+    {
+        return 0;
+    }
+
+    uint32_t tail_page = _atlases_count - 2;
+
+    uint32_t best_tail_width = 0;
+    uint32_t best_tail_height = 0;
+    uint32_t best_atlases_count = _atlases_count;
+    uint64_t best_atlases_area = _atlases_area;
+
+    uint32_t base_max_width = _data->pack->bounds_width;
+    uint32_t base_max_height = _data->pack->bounds_height;
+
+    //the pages before the tail are packed exactly as before, only the last two are repacked together
+    for( uint32_t tail_width = base_max_width; tail_width != 0 && tail_width <= _data->atlas_max_width; tail_width = __texpacker_double_cap( tail_width ) )
+    {
+        if( texpacker_time_budget_exceeded( _data ) == 1 )
+        {
+            break;
+        }
+
+        for( uint32_t tail_height = base_max_height; tail_height != 0 && tail_height <= _data->atlas_max_height; tail_height = __texpacker_double_cap( tail_height ) )
+        {
+            if( tail_width == _data->atlas_max_width && tail_height == _data->atlas_max_height )
+            {
+                continue;
+            }
+
+            if( texpacker_time_budget_exceeded( _data ) == 1 )
+            {
+                printf( "multi bin: time budget %u ms exceeded\n", _data->atlas_time_budget );
+
+                break;
+            }
+
+            texpacker_in_data_t probe_data = *_data;
+            probe_data.atlas_tail_page = tail_page;
+            probe_data.atlas_tail_max_width = tail_width;
+            probe_data.atlas_tail_max_height = tail_height;
+
+            uint32_t atlases_count;
+            uint64_t atlases_area;
+            if( texpacker_probe_atlases( &probe_data, &atlases_count, &atlases_area ) != 0 )
+            {
+                continue;
+            }
+
+            if( atlases_count < best_atlases_count || (atlases_count == best_atlases_count && atlases_area < best_atlases_area) )
+            {
+                best_tail_width = tail_width;
+                best_tail_height = tail_height;
+                best_atlases_count = atlases_count;
+                best_atlases_area = atlases_area;
+            }
+        }
+    }
+
+    if( best_tail_width == 0 )
+    {
+        return 0;
+    }
+
+    printf( "multi bin: tail %ux%u from page %u atlases %u area %llu\n", best_tail_width, best_tail_height, tail_page, best_atlases_count, (unsigned long long)best_atlases_area );
+
+    _data->atlas_tail_page = tail_page;
+    _data->atlas_tail_max_width = best_tail_width;
+    _data->atlas_tail_max_height = best_tail_height;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_balance_atlases( texpacker_in_data_t * const _data )
+{
+    if( _data->atlas_multi_bin == 0 || _data->textures_count == 0 )
+    {
+        return 0;
+    }
+
+    uint32_t best_atlases_count;
+    uint64_t best_atlases_area;
+    if( texpacker_probe_atlases( _data, &best_atlases_count, &best_atlases_area ) != 0 )
+    {
+        return 1;
+    }
+
+    uint32_t best_max_width = _data->atlas_max_width;
+    uint32_t best_max_height = _data->atlas_max_height;
+
+    printf( "multi bin: greedy %ux%u atlases %u area %llu\n", best_max_width, best_max_height, best_atlases_count, (unsigned long long)best_atlases_area );
+
+    uint32_t base_max_width = _data->pack->bounds_width;
+    uint32_t base_max_height = _data->pack->bounds_height;
+
+    for( uint32_t probe_max_width = base_max_width; probe_max_width != 0 && probe_max_width <= _data->atlas_max_width; probe_max_width = __texpacker_double_cap( probe_max_width ) )
+    {
+        if( texpacker_time_budget_exceeded( _data ) == 1 )
+        {
+            break;
+        }
+
+        for( uint32_t probe_max_height = base_max_height; probe_max_height != 0 && probe_max_height <= _data->atlas_max_height; probe_max_height = __texpacker_double_cap( probe_max_height ) )
+        {
+            if( probe_max_width == _data->atlas_max_width && probe_max_height == _data->atlas_max_height )
+            {
+                continue;
+            }
+
+            if( texpacker_time_budget_exceeded( _data ) == 1 )
+            {
+                printf( "multi bin: time budget %u ms exceeded\n", _data->atlas_time_budget );
+
+                break;
+            }
+
+            texpacker_in_data_t probe_data = *_data;
+            probe_data.atlas_max_width = probe_max_width;
+            probe_data.atlas_max_height = probe_max_height;
+
+            uint32_t atlases_count;
+            uint64_t atlases_area;
+            if( texpacker_probe_atlases( &probe_data, &atlases_count, &atlases_area ) != 0 )
+            {
+                continue;
+            }
+
+            if( atlases_count < best_atlases_count || (atlases_count == best_atlases_count && atlases_area < best_atlases_area) )
+            {
+                best_max_width = probe_max_width;
+                best_max_height = probe_max_height;
+                best_atlases_count = atlases_count;
+                best_atlases_area = atlases_area;
+            }
+        }
+    }
+
+    printf( "multi bin: best %ux%u atlases %u area %llu\n", best_max_width, best_max_height, best_atlases_count, (unsigned long long)best_atlases_area );
+
+    _data->atlas_max_width = best_max_width;
+    _data->atlas_max_height = best_max_height;
+
+    if( texpacker_balance_tail_atlases( _data, best_atlases_count, best_atlases_area ) != 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void __texpacker_stbi_write( void * _context, void * _data, int _size )
+{
+    FILE * f = (FILE *)_context;
+
+    fwrite( _data, _size, 1, f );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_write_atlas_png( const wchar_t * _path, const texpacker_atlas_t * _atlas )
+{
+    FILE * f = _wfopen( _path, L"wb" );
+
+    if( f == NULL )
+    {
+        return 1;
+    }
+
+    int stbi_result = stbi_write_png_to_func( &__texpacker_stbi_write, f, _atlas->width, _atlas->height, _atlas->channel, _atlas->pixels, _atlas->width * _atlas->channel );
+
+    fclose( f );
+
+    if( stbi_result == 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_PNG_WINDOW_SIZE 32768
+#define TEXPACKER_PNG_HASH_SIZE 32768
+#define TEXPACKER_PNG_MIN_MATCH 3
+#define TEXPACKER_PNG_MAX_MATCH 258
+#define TEXPACKER_PNG_MAX_CHAIN 32
+#define TEXPACKER_PNG_IDAT_SIZE 65536
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_png_stream_t
+{
+    FILE * f;
+    int error;
+
+    uint8_t * window;
+    uint32_t window_size;
+    uint32_t window_pos;
+
+    int32_t * head;
+    int32_t * prev;
+
+    uint32_t bit_buffer;
+    uint32_t bit_count;
+
+    uint32_t adler_a;
+    uint32_t adler_b;
+
+    uint8_t * idat;
+    uint32_t idat_size;
+} texpacker_png_stream_t;
+//////////////////////////////////////////////////////////////////////////
+static const uint16_t texpacker_deflate_length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t texpacker_deflate_length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t texpacker_deflate_distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t texpacker_deflate_distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+//////////////////////////////////////////////////////////////////////////
+static const uint8_t texpacker_png_color_types[4] = {0, 4, 2, 6};
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_crc32_table[256];
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_crc32_update( uint32_t _crc, const uint8_t * _data, size_t _size )
+{
+    if( texpacker_crc32_table[1] == 0 )
+    {
+        for( uint32_t n = 0; n != 256; ++n )
+        {
+            uint32_t c = n;
+
+            for( uint32_t k = 0; k != 8; ++k )
+            {
+                c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+            }
+
+            texpacker_crc32_table[n] = c;
+        }
+    }
+
+    uint32_t crc = _crc;
+
+    for( size_t index = 0; index != _size; ++index )
+    {
+        crc = texpacker_crc32_table[(crc ^ _data[index]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+//////////////////////////////////////////////////////////////////////////
+static void __texpacker_write_be32( uint8_t * _dst, uint32_t _value )
+{
+    _dst[0] = (uint8_t)(_value >> 24);
+    _dst[1] = (uint8_t)(_value >> 16);
+    _dst[2] = (uint8_t)(_value >> 8);
+    _dst[3] = (uint8_t)(_value >> 0);
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_png_write_chunk( FILE * _f, const char * _type, const uint8_t * _data, uint32_t _size )
+{
+    uint8_t header[8];
+    __texpacker_write_be32( header, _size );
+    memcpy( header + 4, _type, 4 );
+
+    uint32_t crc = texpacker_crc32_update( 0xFFFFFFFFU, header + 4, 4 );
+    crc = texpacker_crc32_update( crc, _data, _size );
+
+    uint8_t footer[4];
+    __texpacker_write_be32( footer, crc ^ 0xFFFFFFFFU );
+
+    if( fwrite( header, 8, 1, _f ) != 1 )
+    {
+        return 1;
+    }
+
+    if( _size != 0 && fwrite( _data, _size, 1, _f ) != 1 )
+    {
+        return 1;
+    }
+
+    if( fwrite( footer, 4, 1, _f ) != 1 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_flush_idat( texpacker_png_stream_t * _stream )
+{
+    if( _stream->idat_size == 0 )
+    {
+        return;
+    }
+
+    if( texpacker_png_write_chunk( _stream->f, "IDAT", _stream->idat, _stream->idat_size ) != 0 )
+    {
+        _stream->error = 1;
+    }
+
+    _stream->idat_size = 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_put_byte( texpacker_png_stream_t * _stream, uint8_t _byte )
+{
+    _stream->idat[_stream->idat_size++] = _byte;
+
+    if( _stream->idat_size == TEXPACKER_PNG_IDAT_SIZE )
+    {
+        texpacker_png_stream_flush_idat( _stream );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_put_bits( texpacker_png_stream_t * _stream, uint32_t _value, uint32_t _count )
+{
+    _stream->bit_buffer |= _value << _stream->bit_count;
+    _stream->bit_count += _count;
+
+    while( _stream->bit_count >= 8 )
+    {
+        texpacker_png_stream_put_byte( _stream, (uint8_t)(_stream->bit_buffer & 0xFF) );
+
+        _stream->bit_buffer >>= 8;
+        _stream->bit_count -= 8;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_put_code( texpacker_png_stream_t * _stream, uint32_t _code, uint32_t _length )
+{
+    uint32_t reversed = 0;
+
+    for( uint32_t index = 0; index != _length; ++index )
+    {
+        reversed = (reversed << 1) | ((_code >> index) & 1);
+    }
+
+    texpacker_png_stream_put_bits( _stream, reversed, _length );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_put_symbol( texpacker_png_stream_t * _stream, uint32_t _symbol )
+{
+    if( _symbol < 144 )
+    {
+        texpacker_png_stream_put_code( _stream, 0x30 + _symbol, 8 );
+    }
+    else if( _symbol < 256 )
+    {
+        texpacker_png_stream_put_code( _stream, 0x190 + _symbol - 144, 9 );
+    }
+    else if( _symbol < 280 )
+    {
+        texpacker_png_stream_put_code( _stream, _symbol - 256, 7 );
+    }
+    else
+    {
+        texpacker_png_stream_put_code( _stream, 0xC0 + _symbol - 280, 8 );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_put_match( texpacker_png_stream_t * _stream, uint32_t _length, uint32_t _distance )
+{
+    uint32_t length_code = 28;
+
+    while( texpacker_deflate_length_base[length_code] > _length )
+    {
+        --length_code;
+    }
+
+    texpacker_png_stream_put_symbol( _stream, 257 + length_code );
+    texpacker_png_stream_put_bits( _stream, _length - texpacker_deflate_length_base[length_code], texpacker_deflate_length_extra[length_code] );
+
+    uint32_t distance_code = 29;
+
+    while( texpacker_deflate_distance_base[distance_code] > _distance )
+    {
+        --distance_code;
+    }
+
+    texpacker_png_stream_put_code( _stream, distance_code, 5 );
+    texpacker_png_stream_put_bits( _stream, _distance - texpacker_deflate_distance_base[distance_code], texpacker_deflate_distance_extra[distance_code] );
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_png_hash( const uint8_t * _p )
+{
+    return (((uint32_t)_p[0] << 10) ^ ((uint32_t)_p[1] << 5) ^ (uint32_t)_p[2]) & (TEXPACKER_PNG_HASH_SIZE - 1);
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_insert( texpacker_png_stream_t * _stream, uint32_t _pos )
+{
+    uint32_t h = __texpacker_png_hash( _stream->window + _pos );
+
+    _stream->prev[_pos & (TEXPACKER_PNG_WINDOW_SIZE - 1)] = _stream->head[h];
+    _stream->head[h] = (int32_t)_pos;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_compress( texpacker_png_stream_t * _stream, uint32_t _limit )
+{
+    const uint8_t * window = _stream->window;
+
+    while( _stream->window_pos < _limit )
+    {
+        uint32_t pos = _stream->window_pos;
+        uint32_t avail = _stream->window_size - pos;
+
+        uint32_t best_length = 0;
+        uint32_t best_distance = 0;
+
+        if( avail >= TEXPACKER_PNG_MIN_MATCH )
+        {
+            uint32_t max_length = avail < TEXPACKER_PNG_MAX_MATCH ? avail : TEXPACKER_PNG_MAX_MATCH;
+
+            int32_t candidate = _stream->head[__texpacker_png_hash( window + pos )];
+
+            for( uint32_t chain = 0; chain != TEXPACKER_PNG_MAX_CHAIN && candidate >= 0; ++chain )
+            {
+                uint32_t distance = pos - (uint32_t)candidate;
+
+                if( distance > TEXPACKER_PNG_WINDOW_SIZE )
+                {
+                    break;
+                }
+
+                const uint8_t * a = window + pos;
+                const uint8_t * b = window + candidate;
+
+                uint32_t length = 0;
+
+                while( length != max_length && a[length] == b[length] )
+                {
+                    ++length;
+                }
+
+                if( length > best_length )
+                {
+                    best_length = length;
+                    best_distance = distance;
+
+                    if( length == max_length )
+                    {
+                        break;
+                    }
+                }
+
+                candidate = _stream->prev[candidate & (TEXPACKER_PNG_WINDOW_SIZE - 1)];
+            }
+
+            texpacker_png_stream_insert( _stream, pos );
+        }
+
+        if( best_length >= TEXPACKER_PNG_MIN_MATCH )
+        {
+            texpacker_png_stream_put_match( _stream, best_length, best_distance );
+
+            for( uint32_t index = 1; index != best_length; ++index )
+            {
+                if( pos + index + TEXPACKER_PNG_MIN_MATCH > _stream->window_size )
+                {
+                    break;
+                }
+
+                texpacker_png_stream_insert( _stream, pos + index );
+            }
+
+            _stream->window_pos += best_length;
+        }
+        else
+        {
+            texpacker_png_stream_put_symbol( _stream, window[pos] );
+
+            _stream->window_pos += 1;
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_slide( texpacker_png_stream_t * _stream )
+{
+    memmove( _stream->window, _stream->window + TEXPACKER_PNG_WINDOW_SIZE, _stream->window_size - TEXPACKER_PNG_WINDOW_SIZE );
+
+    _stream->window_size -= TEXPACKER_PNG_WINDOW_SIZE;
+    _stream->window_pos -= TEXPACKER_PNG_WINDOW_SIZE;
+
+    for( uint32_t index = 0; index != TEXPACKER_PNG_HASH_SIZE; ++index )
+    {
+        int32_t pos = _stream->head[index] - TEXPACKER_PNG_WINDOW_SIZE;
+        _stream->head[index] = pos >= 0 ? pos : -1;
+    }
+
+    for( uint32_t index = 0; index != TEXPACKER_PNG_WINDOW_SIZE; ++index )
+    {
+        int32_t pos = _stream->prev[index] - TEXPACKER_PNG_WINDOW_SIZE;
+        _stream->prev[index] = pos >= 0 ? pos : -1;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_write( texpacker_png_stream_t * _stream, const uint8_t * _data, size_t _size )
+{
+    uint32_t a = _stream->adler_a;
+    uint32_t b = _stream->adler_b;
+
+    for( size_t index = 0; index != _size; )
+    {
+        size_t block = _size - index < 5552 ? _size - index : 5552;
+
+        for( size_t block_index = 0; block_index != block; ++block_index )
+        {
+            a += _data[index + block_index];
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+
+        index += block;
+    }
+
+    _stream->adler_a = a;
+    _stream->adler_b = b;
+
+    while( _size != 0 )
+    {
+        uint32_t space = TEXPACKER_PNG_WINDOW_SIZE * 2 - _stream->window_size;
+        uint32_t copy = _size < space ? (uint32_t)_size : space;
+
+        memcpy( _stream->window + _stream->window_size, _data, copy );
+        _stream->window_size += copy;
+
+        _data += copy;
+        _size -= copy;
+
+        if( _stream->window_size == TEXPACKER_PNG_WINDOW_SIZE * 2 )
+        {
+            texpacker_png_stream_compress( _stream, _stream->window_size - TEXPACKER_PNG_MAX_MATCH );
+            texpacker_png_stream_slide( _stream );
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static int __texpacker_png_stream_begin( texpacker_png_stream_t * const _stream, const wchar_t * _path, uint32_t _width, uint32_t _height, uint8_t _color_type, const uint8_t * _palette, uint32_t _palette_count )
+{
+    FILE * f = _wfopen( _path, L"wb" );
+
+    if( f == NULL )
+    {
+        return 1;
+    }
+
+    static const uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+    uint8_t ihdr[13];
+    __texpacker_write_be32( ihdr + 0, _width );
+    __texpacker_write_be32( ihdr + 4, _height );
+    ihdr[8] = 8;
+    ihdr[9] = _color_type;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    if( fwrite( png_signature, sizeof( png_signature ), 1, f ) != 1 || texpacker_png_write_chunk( f, "IHDR", ihdr, sizeof( ihdr ) ) != 0 )
+    {
+        fclose( f );
+
+        return 1;
+    }
+
+    if( _palette_count != 0 )
+    {
+        //palette entries are rgba, PLTE takes the rgb and tRNS the alpha up to the last translucent entry
+        uint8_t plte[256 * 3];
+        uint8_t trns[256];
+        uint32_t trns_count = 0;
+
+        for( uint32_t index = 0; index != _palette_count; ++index )
+        {
+            plte[index * 3 + 0] = _palette[index * 4 + 0];
+            plte[index * 3 + 1] = _palette[index * 4 + 1];
+            plte[index * 3 + 2] = _palette[index * 4 + 2];
+
+            trns[index] = _palette[index * 4 + 3];
+
+            if( trns[index] != 255 )
+            {
+                trns_count = index + 1;
+            }
+        }
+
+        if( texpacker_png_write_chunk( f, "PLTE", plte, _palette_count * 3 ) != 0 || (trns_count != 0 && texpacker_png_write_chunk( f, "tRNS", trns, trns_count ) != 0) )
+        {
+            fclose( f );
+
+            return 1;
+        }
+    }
+
+    _stream->f = f;
+    _stream->error = 0;
+
+    _stream->window = TEXPACKER_NEWN( uint8_t, TEXPACKER_PNG_WINDOW_SIZE * 2 );
+    _stream->window_size = 0;
+    _stream->window_pos = 0;
+
+    _stream->head = TEXPACKER_NEWN( int32_t, TEXPACKER_PNG_HASH_SIZE );
+    _stream->prev = TEXPACKER_NEWN( int32_t, TEXPACKER_PNG_WINDOW_SIZE );
+    memset( _stream->head, 0xFF, TEXPACKER_PNG_HASH_SIZE * sizeof( int32_t ) );
+    memset( _stream->prev, 0xFF, TEXPACKER_PNG_WINDOW_SIZE * sizeof( int32_t ) );
+
+    _stream->bit_buffer = 0;
+    _stream->bit_count = 0;
+
+    _stream->adler_a = 1;
+    _stream->adler_b = 0;
+
+    _stream->idat = TEXPACKER_NEWN( uint8_t, TEXPACKER_PNG_IDAT_SIZE );
+    _stream->idat_size = 0;
+
+    //zlib header, then a single final block with the fixed huffman codes
+    texpacker_png_stream_put_byte( _stream, 0x78 );
+    texpacker_png_stream_put_byte( _stream, 0x01 );
+    texpacker_png_stream_put_bits( _stream, 1, 1 );
+    texpacker_png_stream_put_bits( _stream, 1, 2 );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_png_stream_begin( texpacker_png_stream_t * const _stream, const wchar_t * _path, uint32_t _width, uint32_t _height, uint32_t _channel )
+{
+    return __texpacker_png_stream_begin( _stream, _path, _width, _height, texpacker_png_color_types[_channel - 1], NULL, 0 );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_png_stream_begin_palette( texpacker_png_stream_t * const _stream, const wchar_t * _path, uint32_t _width, uint32_t _height, const uint8_t * _palette, uint32_t _palette_count )
+{
+    return __texpacker_png_stream_begin( _stream, _path, _width, _height, 3, _palette, _palette_count );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_png_stream_end( texpacker_png_stream_t * const _stream )
+{
+    texpacker_png_stream_compress( _stream, _stream->window_size );
+    texpacker_png_stream_put_symbol( _stream, 256 );
+
+    if( _stream->bit_count != 0 )
+    {
+        texpacker_png_stream_put_bits( _stream, 0, 8 - _stream->bit_count );
+    }
+
+    uint8_t adler[4];
+    __texpacker_write_be32( adler, (_stream->adler_b << 16) | _stream->adler_a );
+
+    for( uint32_t index = 0; index != 4; ++index )
+    {
+        texpacker_png_stream_put_byte( _stream, adler[index] );
+    }
+
+    texpacker_png_stream_flush_idat( _stream );
+
+    if( texpacker_png_write_chunk( _stream->f, "IEND", NULL, 0 ) != 0 )
+    {
+        _stream->error = 1;
+    }
+
+    fclose( _stream->f );
+
+    free( _stream->window );
+    free( _stream->head );
+    free( _stream->prev );
+    free( _stream->idat );
+
+    return _stream->error;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint8_t __texpacker_png_paeth( uint8_t _a, uint8_t _b, uint8_t _c )
+{
+    int32_t p = (int32_t)_a + (int32_t)_b - (int32_t)_c;
+    int32_t pa = abs( p - (int32_t)_a );
+    int32_t pb = abs( p - (int32_t)_b );
+    int32_t pc = abs( p - (int32_t)_c );
+
+    if( pa <= pb && pa <= pc )
+    {
+        return _a;
+    }
+
+    if( pb <= pc )
+    {
+        return _b;
+    }
+
+    return _c;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_filter_row( uint8_t * _dst, const uint8_t * _row, const uint8_t * _prev, uint32_t _row_size, uint32_t _pixel_size, uint32_t _filter )
+{
+    _dst[0] = (uint8_t)_filter;
+
+    for( uint32_t index = 0; index != _row_size; ++index )
+    {
+        uint8_t a = index >= _pixel_size ? _row[index - _pixel_size] : 0;
+        uint8_t b = _prev[index];
+        uint8_t c = index >= _pixel_size ? _prev[index - _pixel_size] : 0;
+
+        uint8_t predict;
+
+        switch( _filter )
+        {
+        case 1: predict = a; break;
+        case 2: predict = b; break;
+        case 3: predict = (uint8_t)(((uint32_t)a + (uint32_t)b) >> 1); break;
+        case 4: predict = __texpacker_png_paeth( a, b, c ); break;
+        default: predict = 0; break;
+        }
+
+        _dst[index + 1] = (uint8_t)(_row[index] - predict);
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_png_stream_write_row( texpacker_png_stream_t * _stream, const uint8_t * _row, const uint8_t * _prev, uint32_t _row_size, uint32_t _pixel_size, uint8_t * _scratch )
+{
+    uint8_t * best = _scratch;
+    uint8_t * candidate = _scratch + _row_size + 1;
+
+    uint64_t best_sum = UINT64_MAX;
+
+    for( uint32_t filter = 0; filter != 5; ++filter )
+    {
+        texpacker_png_filter_row( candidate, _row, _prev, _row_size, _pixel_size, filter );
+
+        uint64_t sum = 0;
+
+        for( uint32_t index = 0; index != _row_size; ++index )
+        {
+            sum += (uint64_t)abs( (int8_t)candidate[index + 1] );
+        }
+
+        if( sum < best_sum )
+        {
+            best_sum = sum;
+
+            uint8_t * swap = best;
+            best = candidate;
+            candidate = swap;
+        }
+    }
+
+    texpacker_png_stream_write( _stream, best, _row_size + 1 );
+}
+//////////////////////////////////////////////////////////////////////////
+static int __textures_compare_atlas_rect_y( void const * _el1, void const * _el2 )
+{
+    const texpacker_texture_t * t1 = *(const texpacker_texture_t * const *)_el1;
+    const texpacker_texture_t * t2 = *(const texpacker_texture_t * const *)_el2;
+
+    uint32_t y1 = texpacker_get_texture_rect( t1 )->y;
+    uint32_t y2 = texpacker_get_texture_rect( t2 )->y;
+
+    return (y1 > y2) - (y1 < y2);
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_write_atlas_png_strips( const texpacker_in_data_t * const _data, texpacker_atlas_t * _atlas, const wchar_t * _path )
+{
+    uint32_t strip_height = _data->output_strip_height;
+
+    uint32_t atlas_width = _atlas->width;
+    uint32_t atlas_height = _atlas->height;
+    uint32_t atlas_pixel_size = _atlas->channel * sizeof( uint8_t );
+    uint32_t atlas_row_size = atlas_width * atlas_pixel_size;
+
+    const texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t placed_count = 0;
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        if( pack->page[index] == _atlas->index )
+        {
+            ++placed_count;
+        }
+    }
+
+    uint32_t placed_capacity = placed_count + 1;
+
+    texpacker_texture_t ** placed = TEXPACKER_NEWN( texpacker_texture_t *, placed_capacity );
+    texpacker_texture_t ** active = TEXPACKER_NEWN( texpacker_texture_t *, placed_capacity );
+
+    placed_count = 0;
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        if( pack->page[index] == _atlas->index )
+        {
+            placed[placed_count++] = _data->textures + index;
+        }
+    }
+
+    qsort( placed, placed_count, sizeof( texpacker_texture_t * ), &__textures_compare_atlas_rect_y );
+
+    texpacker_png_stream_t stream;
+    if( texpacker_png_stream_begin( &stream, _path, atlas_width, atlas_height, _atlas->channel ) != 0 )
+    {
+        free( placed );
+        free( active );
+
+        return 1;
+    }
+
+    //one extra row above and below each strip so the bleed kernel sees its neighbours
+    size_t strip_size = (size_t)(strip_height + 2) * atlas_row_size;
+    uint8_t * strip_pixels = TEXPACKER_NEWN( uint8_t, strip_size );
+
+    uint8_t * prev_row = TEXPACKER_NEWN( uint8_t, atlas_row_size );
+    memset( prev_row, 0x00, atlas_row_size );
+
+    uint8_t * filter_scratch = TEXPACKER_NEWN( uint8_t, (atlas_row_size + 1) * 2 );
+
+    uint32_t placed_next = 0;
+    uint32_t active_count = 0;
+
+    for( uint32_t y0 = 0; y0 < atlas_height; y0 += strip_height )
+    {
+        uint32_t y1 = atlas_height - y0 < strip_height ? atlas_height : y0 + strip_height;
+
+        uint32_t pixels_y0 = y0 == 0 ? 0 : y0 - 1;
+        uint32_t pixels_y1 = y1 == atlas_height ? atlas_height : y1 + 1;
+
+        _atlas->pixels = strip_pixels;
+        _atlas->pixels_y = pixels_y0;
+        _atlas->pixels_height = pixels_y1 - pixels_y0;
+
+        memset( strip_pixels, 0x00, (size_t)_atlas->pixels_height * atlas_row_size );
+
+        while( placed_next != placed_count && texpacker_get_texture_rect( placed[placed_next] )->y < pixels_y1 )
+        {
+            active[active_count++] = placed[placed_next++];
+        }
+
+        uint64_t render_begin = texpacker_trace_begin( _data );
+
+        uint32_t active_keep = 0;
+
+        for( uint32_t index = 0; index != active_count; ++index )
+        {
+            texpacker_texture_t * texture = active[index];
+
+            texpacker_render_atlas_texture( _data, _atlas, texture );
+
+            const texpacker_atlas_rect_t * r = texpacker_get_texture_rect( texture );
+
+            if( r->y + r->v >= y1 )
+            {
+                active[active_keep++] = texture;
+            }
+        }
+
+        active_count = active_keep;
+
+        if( _data->atlas_debug_outline == 1 )
+        {
+            texpacker_render_rect_border( _atlas, 0, 0, atlas_width, atlas_height, 255, 0, 0, 255 );
+        }
+
+        texpacker_trace_end( _data, "render", render_begin, TEXPACKER_TRACE_NONE, _atlas->index );
+
+        uint64_t bleed_begin = texpacker_trace_begin( _data );
+
+        texpacker_correct_atlas_alpha_pixels( _atlas, y0, y1 );
+
+        texpacker_trace_end( _data, "bleed", bleed_begin, TEXPACKER_TRACE_NONE, _atlas->index );
+
+        for( uint32_t y = y0; y != y1; ++y )
+        {
+            const uint8_t * atlas_row = texpacker_get_atlas_row( _atlas, y );
+
+            texpacker_png_stream_write_row( &stream, atlas_row, prev_row, atlas_row_size, atlas_pixel_size, filter_scratch );
+
+            memcpy( prev_row, atlas_row, atlas_row_size );
+        }
+    }
+
+    _atlas->pixels = NULL;
+    _atlas->pixels_y = 0;
+    _atlas->pixels_height = 0;
+
+    free( strip_pixels );
+    free( prev_row );
+    free( filter_scratch );
+    free( placed );
+    free( active );
+
+    if( texpacker_png_stream_end( &stream ) != 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_PALETTE_MAX_COLORS 256
+#define TEXPACKER_PALETTE_MAX_SAMPLES (1U << 18)
+#define TEXPACKER_PALETTE_KMEANS_ITERATIONS 4
+#define TEXPACKER_PALETTE_CACHE_SIZE 4096
+//////////////////////////////////////////////////////////////////////////
+static const uint8_t texpacker_palette_components[4][4] = {{0}, {0, 3}, {0, 1, 2}, {0, 1, 2, 3}};
+//////////////////////////////////////////////////////////////////////////
+static const int32_t texpacker_palette_bayer[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_palette_fetch( const uint8_t * _pixel, uint32_t _channel )
+{
+    //colors are packed rgba with red in the low byte, gray is spread over rgb
+    uint32_t color;
+
+    switch( _channel )
+    {
+    case 1: color = ((uint32_t)_pixel[0] * 0x010101U) | 0xFF000000U; break;
+    case 2: color = ((uint32_t)_pixel[0] * 0x010101U) | ((uint32_t)_pixel[1] << 24); break;
+    case 3: color = (uint32_t)_pixel[0] | ((uint32_t)_pixel[1] << 8) | ((uint32_t)_pixel[2] << 16) | 0xFF000000U; break;
+    default: color = (uint32_t)_pixel[0] | ((uint32_t)_pixel[1] << 8) | ((uint32_t)_pixel[2] << 16) | ((uint32_t)_pixel[3] << 24); break;
+    }
+
+    //the alpha bleed averages neighbours into invisible pixels, in a palette they all share one entry
+    if( (color >> 24) == 0 )
+    {
+        return 0;
+    }
+
+    return color;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_palette_component( uint32_t _color, uint32_t _component )
+{
+    return (_color >> (_component * 8)) & 0xFF;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_palette_distance( uint32_t _a, uint32_t _b )
+{
+    uint32_t distance = 0;
+
+    for( uint32_t component = 0; component != 4; ++component )
+    {
+        int32_t d = (int32_t)__texpacker_palette_component( _a, component ) - (int32_t)__texpacker_palette_component( _b, component );
+
+        distance += (uint32_t)(d * d);
+    }
+
+    return distance;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_palette_search_t
+{
+    uint32_t count;
+    uint32_t colors[TEXPACKER_PALETTE_MAX_COLORS];
+    uint32_t keys[TEXPACKER_PALETTE_MAX_COLORS];
+    uint8_t indices[TEXPACKER_PALETTE_MAX_COLORS];
+} texpacker_palette_search_t;
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_palette_key( uint32_t _color )
+{
+    return __texpacker_palette_component( _color, 0 ) + __texpacker_palette_component( _color, 1 ) + __texpacker_palette_component( _color, 2 ) + __texpacker_palette_component( _color, 3 );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_palette_search_init( texpacker_palette_search_t * const _search, const uint32_t * _palette, uint32_t _count )
+{
+    _search->count = _count;
+
+    for( uint32_t index = 0; index != _count; ++index )
+    {
+        uint32_t color = _palette[index];
+        uint32_t key = __texpacker_palette_key( color );
+
+        uint32_t insert = index;
+
+        while( insert != 0 && _search->keys[insert - 1] > key )
+        {
+            _search->colors[insert] = _search->colors[insert - 1];
+            _search->keys[insert] = _search->keys[insert - 1];
+            _search->indices[insert] = _search->indices[insert - 1];
+
+            --insert;
+        }
+
+        _search->colors[insert] = color;
+        _search->keys[insert] = key;
+        _search->indices[insert] = (uint8_t)index;
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_palette_search_nearest( const texpacker_palette_search_t * _search, uint32_t _color )
+{
+    //entries are sorted by component sum, and (sum difference)^2 / 4 never exceeds the distance
+    uint32_t key = __texpacker_palette_key( _color );
+
+    uint32_t lo = 0;
+    uint32_t hi = _search->count;
+
+    while( lo != hi )
+    {
+        uint32_t middle = (lo + hi) / 2;
+
+        if( _search->keys[middle] < key )
+        {
+            lo = middle + 1;
+        }
+        else
+        {
+            hi = middle;
+        }
+    }
+
+    uint32_t best_index = 0;
+    uint64_t best_distance = UINT64_MAX;
+
+    uint32_t up = lo;
+    uint32_t down = lo;
+
+    uint32_t up_open = 1;
+    uint32_t down_open = 1;
+
+    while( (up_open == 1 || down_open == 1) && best_distance != 0 )
+    {
+        if( up_open == 1 )
+        {
+            if( up == _search->count || (uint64_t)(_search->keys[up] - key) * (_search->keys[up] - key) > best_distance * 4 )
+            {
+                up_open = 0;
+            }
+            else
+            {
+                uint32_t distance = __texpacker_palette_distance( _search->colors[up], _color );
+
+                if( distance < best_distance )
+                {
+                    best_distance = distance;
+                    best_index = up;
+                }
+
+                ++up;
+            }
+        }
+
+        if( down_open == 1 )
+        {
+            if( down == 0 || (uint64_t)(key - _search->keys[down - 1]) * (key - _search->keys[down - 1]) > best_distance * 4 )
+            {
+                down_open = 0;
+            }
+            else
+            {
+                --down;
+
+                uint32_t distance = __texpacker_palette_distance( _search->colors[down], _color );
+
+                if( distance < best_distance )
+                {
+                    best_distance = distance;
+                    best_index = down;
+                }
+            }
+        }
+    }
+
+    return _search->indices[best_index];
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_palette_exact( const texpacker_atlas_t * _atlas, uint32_t _max_colors, uint32_t * const _palette )
+{
+    //open addressing over a table four times the palette, stops as soon as the palette overflows
+    uint32_t table_keys[TEXPACKER_PALETTE_MAX_COLORS * 4];
+    uint8_t table_used[TEXPACKER_PALETTE_MAX_COLORS * 4];
+    memset( table_used, 0, sizeof( table_used ) );
+
+    uint32_t count = 0;
+
+    size_t pixels_count = (size_t)_atlas->width * _atlas->height;
+
+    const uint8_t * pixels = (const uint8_t *)_atlas->pixels;
+
+    uint32_t last_color = 0;
+    uint32_t last_valid = 0;
+
+    for( size_t index = 0; index != pixels_count; ++index )
+    {
+        uint32_t color = __texpacker_palette_fetch( pixels + index * _atlas->channel, _atlas->channel );
+
+        if( last_valid == 1 && color == last_color )
+        {
+            continue;
+        }
+
+        last_color = color;
+        last_valid = 1;
+
+        uint32_t slot = (color * 2654435761U) >> 22;
+
+        while( table_used[slot] == 1 && table_keys[slot] != color )
+        {
+            slot = (slot + 1) & (TEXPACKER_PALETTE_MAX_COLORS * 4 - 1);
+        }
+
+        if( table_used[slot] == 1 )
+        {
+            continue;
+        }
+
+        if( count == _max_colors )
+        {
+            return _max_colors + 1;
+        }
+
+        table_used[slot] = 1;
+        table_keys[slot] = color;
+
+        _palette[count++] = color;
+    }
+
+    return count;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_palette_box_t
+{
+    uint32_t begin;
+    uint32_t end;
+    uint32_t component;
+    uint32_t range;
+} texpacker_palette_box_t;
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_palette_box_extent( const uint32_t * _samples, texpacker_palette_box_t * const _box )
+{
+    uint32_t min[4] = {255, 255, 255, 255};
+    uint32_t max[4] = {0, 0, 0, 0};
+
+    for( uint32_t index = _box->begin; index != _box->end; ++index )
+    {
+        for( uint32_t component = 0; component != 4; ++component )
+        {
+            uint32_t value = __texpacker_palette_component( _samples[index], component );
+
+            min[component] = value < min[component] ? value : min[component];
+            max[component] = value > max[component] ? value : max[component];
+        }
+    }
+
+    _box->component = 0;
+    _box->range = 0;
+
+    for( uint32_t component = 0; component != 4; ++component )
+    {
+        uint32_t range = max[component] - min[component];
+
+        if( range > _box->range )
+        {
+            _box->component = component;
+            _box->range = range;
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_palette_box_sort( uint32_t * _samples, uint32_t * _scratch, const texpacker_palette_box_t * _box )
+{
+    //counting sort on the split component, the samples are bytes so this stays linear
+    uint32_t offsets[257];
+    memset( offsets, 0, sizeof( offsets ) );
+
+    for( uint32_t index = _box->begin; index != _box->end; ++index )
+    {
+        ++offsets[__texpacker_palette_component( _samples[index], _box->component ) + 1];
+    }
+
+    for( uint32_t value = 0; value != 256; ++value )
+    {
+        offsets[value + 1] += offsets[value];
+    }
+
+    for( uint32_t index = _box->begin; index != _box->end; ++index )
+    {
+        uint32_t value = __texpacker_palette_component( _samples[index], _box->component );
+
+        _scratch[offsets[value]++] = _samples[index];
+    }
+
+    memcpy( _samples + _box->begin, _scratch, (_box->end - _box->begin) * sizeof( uint32_t ) );
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t __texpacker_palette_mean( const uint64_t * _sums )
+{
+    uint64_t count = _sums[4];
+
+    uint32_t color = 0;
+
+    for( uint32_t component = 0; component != 4; ++component )
+    {
+        color |= (uint32_t)((_sums[component] + count / 2) / count) << (component * 8);
+    }
+
+    return color;
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_palette_median_cut( uint32_t * _samples, uint32_t _samples_count, uint32_t _max_colors, uint32_t * const _palette )
+{
+    texpacker_palette_box_t boxes[TEXPACKER_PALETTE_MAX_COLORS];
+    uint32_t boxes_count = 1;
+
+    boxes[0].begin = 0;
+    boxes[0].end = _samples_count;
+    texpacker_palette_box_extent( _samples, boxes + 0 );
+
+    uint32_t * scratch = TEXPACKER_NEWN( uint32_t, _samples_count );
+
+    while( boxes_count != _max_colors )
+    {
+        uint32_t best_box = TEXPACKER_PALETTE_MAX_COLORS;
+        uint64_t best_score = 0;
+
+        for( uint32_t index = 0; index != boxes_count; ++index )
+        {
+            const texpacker_palette_box_t * box = boxes + index;
+
+            uint64_t score = (uint64_t)box->range * (box->end - box->begin);
+
+            if( box->end - box->begin >= 2 && score > best_score )
+            {
+                best_score = score;
+                best_box = index;
+            }
+        }
+
+        if( best_box == TEXPACKER_PALETTE_MAX_COLORS )
+        {
+            break;
+        }
+
+        texpacker_palette_box_t * box = boxes + best_box;
+
+        texpacker_palette_box_sort( _samples, scratch, box );
+
+        uint32_t middle = box->begin + (box->end - box->begin) / 2;
+
+        texpacker_palette_box_t * split = boxes + boxes_count++;
+        split->begin = middle;
+        split->end = box->end;
+
+        box->end = middle;
+
+        texpacker_palette_box_extent( _samples, box );
+        texpacker_palette_box_extent( _samples, split );
+    }
+
+    free( scratch );
+
+    for( uint32_t index = 0; index != boxes_count; ++index )
+    {
+        const texpacker_palette_box_t * box = boxes + index;
+
+        uint64_t sums[5] = {0, 0, 0, 0, box->end - box->begin};
+
+        for( uint32_t sample = box->begin; sample != box->end; ++sample )
+        {
+            for( uint32_t component = 0; component != 4; ++component )
+            {
+                sums[component] += __texpacker_palette_component( _samples[sample], component );
+            }
+        }
+
+        _palette[index] = __texpacker_palette_mean( sums );
+    }
+
+    return boxes_count;
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_palette_job_t
+{
+    const uint32_t * palette;
+    const texpacker_palette_search_t * search;
+
+    const uint32_t * samples;
+    uint32_t samples_begin;
+    uint32_t samples_end;
+    uint64_t sums[TEXPACKER_PALETTE_MAX_COLORS][5];
+
+    const texpacker_atlas_t * atlas;
+    uint8_t * indices;
+    uint32_t y0;
+    uint32_t y1;
+    int32_t dither;
+    uint64_t error_sum;
+    uint32_t error_max;
+
+    uint32_t cache_keys[TEXPACKER_PALETTE_CACHE_SIZE];
+    uint8_t cache_values[TEXPACKER_PALETTE_CACHE_SIZE];
+    uint8_t cache_used[TEXPACKER_PALETTE_CACHE_SIZE];
+} texpacker_palette_job_t;
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_palette_assign_worker( void * _ud )
+{
+    texpacker_palette_job_t * job = (texpacker_palette_job_t *)_ud;
+
+    memset( job->sums, 0, sizeof( job->sums ) );
+
+    for( uint32_t index = job->samples_begin; index != job->samples_end; ++index )
+    {
+        uint32_t color = job->samples[index];
+
+        uint32_t nearest = texpacker_palette_search_nearest( job->search, color );
+
+        uint64_t * sums = job->sums[nearest];
+
+        for( uint32_t component = 0; component != 4; ++component )
+        {
+            sums[component] += __texpacker_palette_component( color, component );
+        }
+
+        ++sums[4];
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_palette_map_worker( void * _ud )
+{
+    texpacker_palette_job_t * job = (texpacker_palette_job_t *)_ud;
+
+    const texpacker_atlas_t * atlas = job->atlas;
+
+    uint32_t channel = atlas->channel;
+
+    const uint8_t * components = texpacker_palette_components[channel - 1];
+
+    memset( job->cache_used, 0, sizeof( job->cache_used ) );
+
+    job->error_sum = 0;
+    job->error_max = 0;
+
+    for( uint32_t y = job->y0; y != job->y1; ++y )
+    {
+        const uint8_t * row = (const uint8_t *)atlas->pixels + (size_t)y * atlas->width * channel;
+        uint8_t * indices = job->indices + (size_t)y * atlas->width;
+
+        for( uint32_t x = 0; x != atlas->width; ++x )
+        {
+            uint32_t color = __texpacker_palette_fetch( row + x * channel, channel );
+            uint32_t target = color;
+
+            if( job->dither != 0 )
+            {
+                //ordered dither keeps rows independent, so bands can be mapped in parallel
+                int32_t offset = (texpacker_palette_bayer[y & 3][x & 3] * 2 - 15) * job->dither / 32;
+
+                target = color & 0xFF000000U;
+
+                for( uint32_t component = 0; component != 3; ++component )
+                {
+                    int32_t value = (int32_t)__texpacker_palette_component( color, component ) + offset;
+                    value = value < 0 ? 0 : (value > 255 ? 255 : value);
+
+                    target |= (uint32_t)value << (component * 8);
+                }
+            }
+
+            uint32_t slot = (target * 2654435761U) >> 20;
+
+            uint32_t nearest;
+
+            if( job->cache_used[slot] == 1 && job->cache_keys[slot] == target )
+            {
+                nearest = job->cache_values[slot];
+            }
+            else
+            {
+                nearest = texpacker_palette_search_nearest( job->search, target );
+
+                job->cache_used[slot] = 1;
+                job->cache_keys[slot] = target;
+                job->cache_values[slot] = (uint8_t)nearest;
+            }
+
+            indices[x] = (uint8_t)nearest;
+
+            uint32_t mapped = job->palette[nearest];
+
+            for( uint32_t index = 0; index != channel; ++index )
+            {
+                uint32_t component = components[index];
+
+                int32_t d = (int32_t)__texpacker_palette_component( color, component ) - (int32_t)__texpacker_palette_component( mapped, component );
+                uint32_t e = (uint32_t)(d < 0 ? -d : d);
+
+                job->error_sum += (uint64_t)(e * e);
+                job->error_max = e > job->error_max ? e : job->error_max;
+            }
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static uint32_t texpacker_palette_quantize( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas, texpacker_palette_job_t * _jobs, uint32_t _jobs_count, uint32_t * const _palette )
+{
+    size_t pixels_count = (size_t)_atlas->width * _atlas->height;
+
+    size_t samples_step = (pixels_count + TEXPACKER_PALETTE_MAX_SAMPLES - 1) / TEXPACKER_PALETTE_MAX_SAMPLES;
+    uint32_t samples_count = (uint32_t)((pixels_count + samples_step - 1) / samples_step);
+
+    uint32_t * samples = TEXPACKER_NEWN( uint32_t, samples_count );
+
+    const uint8_t * pixels = (const uint8_t *)_atlas->pixels;
+
+    for( uint32_t index = 0; index != samples_count; ++index )
+    {
+        samples[index] = __texpacker_palette_fetch( pixels + index * samples_step * _atlas->channel, _atlas->channel );
+    }
+
+    uint32_t palette_count = texpacker_palette_median_cut( samples, samples_count, _data->output_palette_colors, _palette );
+
+    texpacker_palette_search_t * search = TEXPACKER_NEW( texpacker_palette_search_t );
+
+    //median cut boxes only see one axis at a time, a few lloyd passes pull entries onto the clusters
+    for( uint32_t iteration = 0; iteration != TEXPACKER_PALETTE_KMEANS_ITERATIONS; ++iteration )
+    {
+        texpacker_palette_search_init( search, _palette, palette_count );
+
+        for( uint32_t index = 0; index != _jobs_count; ++index )
+        {
+            texpacker_palette_job_t * job = _jobs + index;
+
+            job->palette = _palette;
+            job->search = search;
+            job->samples = samples;
+            job->samples_begin = (uint32_t)((uint64_t)samples_count * index / _jobs_count);
+            job->samples_end = (uint32_t)((uint64_t)samples_count * (index + 1) / _jobs_count);
+        }
+
+        texpacker_run_parallel( &texpacker_palette_assign_worker, _jobs, sizeof( texpacker_palette_job_t ), _jobs_count );
+
+        for( uint32_t entry = 0; entry != palette_count; ++entry )
+        {
+            uint64_t sums[5] = {0, 0, 0, 0, 0};
+
+            for( uint32_t index = 0; index != _jobs_count; ++index )
+            {
+                for( uint32_t component = 0; component != 5; ++component )
+                {
+                    sums[component] += _jobs[index].sums[entry][component];
+                }
+            }
+
+            if( sums[4] != 0 )
+            {
+                _palette[entry] = __texpacker_palette_mean( sums );
+            }
+        }
+    }
+
+    free( search );
+    free( samples );
+
+    return palette_count;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_write_atlas_png_palette( const texpacker_in_data_t * const _data, const wchar_t * _path, const texpacker_atlas_t * _atlas, texpacker_palette_stats_t * const _stats )
+{
+    uint32_t jobs_count = _data->output_palette_threads;
+    jobs_count = jobs_count == 0 ? 1 : (jobs_count > TEXPACKER_PARALLEL_MAX_JOBS ? TEXPACKER_PARALLEL_MAX_JOBS : jobs_count);
+    jobs_count = jobs_count > _atlas->height ? _atlas->height : jobs_count;
+
+    texpacker_palette_job_t * jobs = TEXPACKER_NEWN( texpacker_palette_job_t, jobs_count );
+
+    uint32_t palette[TEXPACKER_PALETTE_MAX_COLORS];
+
+    uint32_t palette_count = texpacker_palette_exact( _atlas, _data->output_palette_colors, palette );
+
+    uint32_t exact = palette_count <= _data->output_palette_colors ? 1 : 0;
+
+    if( exact == 0 )
+    {
+        palette_count = texpacker_palette_quantize( _data, _atlas, jobs, jobs_count, palette );
+    }
+
+    //translucent entries go first so tRNS can stop at the last one
+    uint32_t sorted[TEXPACKER_PALETTE_MAX_COLORS];
+    uint32_t sorted_count = 0;
+
+    for( uint32_t pass = 0; pass != 2; ++pass )
+    {
+        for( uint32_t index = 0; index != palette_count; ++index )
+        {
+            uint32_t opaque = (palette[index] >> 24) == 255 ? 1 : 0;
+
+            if( opaque == pass )
+            {
+                sorted[sorted_count++] = palette[index];
+            }
+        }
+    }
+
+    texpacker_palette_search_t * search = TEXPACKER_NEW( texpacker_palette_search_t );
+    texpacker_palette_search_init( search, sorted, sorted_count );
+
+    int32_t dither = 0;
+
+    if( exact == 0 && _data->output_palette_dither == 1 && sorted_count >= 2 )
+    {
+        //dither spans about one palette step, measured as the mean distance to the nearest other entry
+        double spacing = 0.0;
+
+        for( uint32_t index = 0; index != sorted_count; ++index )
+        {
+            uint32_t nearest_distance = UINT32_MAX;
+
+            for( uint32_t other = 0; other != sorted_count; ++other )
+            {
+                uint32_t distance = __texpacker_palette_distance( sorted[index], sorted[other] );
+
+                if( other != index && distance < nearest_distance )
+                {
+                    nearest_distance = distance;
+                }
+            }
+
+            spacing += sqrt( (double)nearest_distance );
+        }
+
+        dither = (int32_t)(spacing / sorted_count + 0.5);
+    }
+
+    size_t indices_size = (size_t)_atlas->width * _atlas->height;
+    uint8_t * indices = TEXPACKER_NEWN( uint8_t, indices_size );
+
+    for( uint32_t index = 0; index != jobs_count; ++index )
+    {
+        texpacker_palette_job_t * job = jobs + index;
+
+        job->palette = sorted;
+        job->search = search;
+        job->atlas = _atlas;
+        job->indices = indices;
+        job->y0 = (uint32_t)((uint64_t)_atlas->height * index / jobs_count);
+        job->y1 = (uint32_t)((uint64_t)_atlas->height * (index + 1) / jobs_count);
+        job->dither = dither;
+    }
+
+    texpacker_run_parallel( &texpacker_palette_map_worker, jobs, sizeof( texpacker_palette_job_t ), jobs_count );
+
+    uint64_t error_sum = 0;
+    uint32_t error_max = 0;
+
+    for( uint32_t index = 0; index != jobs_count; ++index )
+    {
+        error_sum += jobs[index].error_sum;
+        error_max = jobs[index].error_max > error_max ? jobs[index].error_max : error_max;
+    }
+
+    free( search );
+    free( jobs );
+
+    uint8_t palette_rgba[TEXPACKER_PALETTE_MAX_COLORS * 4];
+
+    for( uint32_t index = 0; index != sorted_count; ++index )
+    {
+        for( uint32_t component = 0; component != 4; ++component )
+        {
+            palette_rgba[index * 4 + component] = (uint8_t)__texpacker_palette_component( sorted[index], component );
+        }
+    }
+
+    texpacker_png_stream_t stream;
+    if( texpacker_png_stream_begin_palette( &stream, _path, _atlas->width, _atlas->height, palette_rgba, sorted_count ) != 0 )
+    {
+        free( indices );
+
+        return 1;
+    }
+
+    //indexed rows compress best unfiltered
+    uint8_t * row = TEXPACKER_NEWN( uint8_t, _atlas->width + 1 );
+    row[0] = 0;
+
+    for( uint32_t y = 0; y != _atlas->height; ++y )
+    {
+        memcpy( row + 1, indices + (size_t)y * _atlas->width, _atlas->width );
+
+        texpacker_png_stream_write( &stream, row, _atlas->width + 1 );
+    }
+
+    free( row );
+    free( indices );
+
+    if( texpacker_png_stream_end( &stream ) != 0 )
+    {
+        return 1;
+    }
+
+    _stats->colors = sorted_count;
+    _stats->exact = exact;
+    _stats->rmse = sqrt( (double)error_sum / ((double)indices_size * _atlas->channel) );
+    _stats->max_error = error_max;
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_write_atlas_image( const texpacker_in_data_t * const _data, const wchar_t * _path, const texpacker_atlas_t * _atlas, texpacker_palette_stats_t * const _stats )
+{
+    if( _data->output_palette == 1 )
+    {
+        if( texpacker_write_atlas_png_palette( _data, _path, _atlas, _stats ) != 0 )
+        {
+            return 1;
+        }
+
+        printf( "palette: %ls colors %u %s rmse %.3f max %u\n", _path, _stats->colors, _stats->exact == 1 ? "exact" : "quantized", _stats->rmse, _stats->max_error );
+
+        return 0;
+    }
+
+    if( texpacker_write_atlas_png( _path, _atlas ) != 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_downsample_rect( const texpacker_atlas_t * _src, texpacker_atlas_t * _dst, uint32_t _factor, uint32_t _sx0, uint32_t _sy0, uint32_t _sx1, uint32_t _sy1, uint32_t _dx0, uint32_t _dy0, uint32_t _dx1, uint32_t _dy1 )
+{
+    uint32_t pixel_size = _src->channel;
+
+    uint32_t src_pitch = _src->width * pixel_size;
+    uint32_t dst_pitch = _dst->width * pixel_size;
+
+    const uint8_t * src_pixels_byte = (const uint8_t *)_src->pixels;
+    uint8_t * dst_pixels_byte = (uint8_t *)_dst->pixels;
+
+    uint32_t samples = _factor * _factor;
+
+    for( uint32_t dy = _dy0; dy != _dy1; ++dy )
+    {
+        uint8_t * dst_row = dst_pixels_byte + dy * dst_pitch;
+
+        for( uint32_t dx = _dx0; dx != _dx1; ++dx )
+        {
+            uint32_t total[4] = {0, 0, 0, 0};
+
+            for( uint32_t fy = 0; fy != _factor; ++fy )
+            {
+                uint32_t sy = dy * _factor + fy;
+                sy = sy < _sy0 ? _sy0 : (sy >= _sy1 ? _sy1 - 1 : sy);
+
+                const uint8_t * src_row = src_pixels_byte + sy * src_pitch;
+
+                for( uint32_t fx = 0; fx != _factor; ++fx )
+                {
+                    uint32_t sx = dx * _factor + fx;
+                    sx = sx < _sx0 ? _sx0 : (sx >= _sx1 ? _sx1 - 1 : sx);
+
+                    const uint8_t * src_pixel = src_row + sx * pixel_size;
+
+                    for( uint32_t index = 0; index != pixel_size; ++index )
+                    {
+                        total[index] += src_pixel[index];
+                    }
+                }
+            }
+
+            uint8_t * dst_pixel = dst_row + dx * pixel_size;
+
+            for( uint32_t index = 0; index != pixel_size; ++index )
+            {
+                dst_pixel[index] = (uint8_t)((total[index] + samples / 2) / samples);
+            }
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_downsample_atlas( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas, const texpacker_atlas_t * _src, uint32_t _src_scale, texpacker_atlas_t * const _dst, uint32_t _factor )
+{
+    uint32_t dst_width = _src->width / _factor;
+    uint32_t dst_height = _src->height / _factor;
+
+    _dst->index = _atlas->index;
+    _dst->width = dst_width != 0 ? dst_width : 1;
+    _dst->height = dst_height != 0 ? dst_height : 1;
+    _dst->channel = _src->channel;
+    _dst->pixels = malloc( _dst->width * _dst->height * _dst->channel * sizeof( uint8_t ) );
+    _dst->pixels_y = 0;
+    _dst->pixels_height = _dst->height;
+
+    texpacker_downsample_rect( _src, _dst, _factor, 0, 0, _src->width, _src->height, 0, 0, _dst->width, _dst->height );
+
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    {
+        if( _data->pack->page[index] != _atlas->index )
+        {
+            continue;
+        }
+
+        const texpacker_atlas_rect_t * r = texpacker_get_texture_rect( _data->textures + index );
+
+        uint32_t sx0 = r->x / _src_scale;
+        uint32_t sy0 = r->y / _src_scale;
+        uint32_t sx1 = (r->x + r->u + _src_scale - 1) / _src_scale;
+        uint32_t sy1 = (r->y + r->v + _src_scale - 1) / _src_scale;
+
+        sx1 = sx1 < _src->width ? sx1 : _src->width;
+        sy1 = sy1 < _src->height ? sy1 : _src->height;
+
+        if( sx0 >= sx1 || sy0 >= sy1 )
+        {
+            continue;
+        }
+
+        uint32_t dx0 = sx0 / _factor;
+        uint32_t dy0 = sy0 / _factor;
+        uint32_t dx1 = (sx1 + _factor - 1) / _factor;
+        uint32_t dy1 = (sy1 + _factor - 1) / _factor;
+
+        dx1 = dx1 < _dst->width ? dx1 : _dst->width;
+        dy1 = dy1 < _dst->height ? dy1 : _dst->height;
+
+        if( dx0 >= dx1 || dy0 >= dy1 )
+        {
+            continue;
+        }
+
+        texpacker_downsample_rect( _src, _dst, _factor, sx0, sy0, sx1, sy1, dx0, dy0, dx1, dy1 );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_save_atlas_mipmaps( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas, uint32_t _scale )
+{
+    const wchar_t * atlas_path_ext = wcsrchr( _atlas->path, L'.' );
+
+    if( atlas_path_ext == NULL )
+    {
+        return 1;
+    }
+
+    const wchar_t * mipmap_path_format = (_data->output_mipmap_path_format != NULL) ? _data->output_mipmap_path_format : L"%.*ls_mip%u%ls";
+
+    texpacker_atlas_t mipmap_src;
+    mipmap_src.width = _atlas->width;
+    mipmap_src.height = _atlas->height;
+    mipmap_src.channel = _atlas->channel;
+    mipmap_src.pixels = _atlas->pixels;
+
+    uint32_t mipmap_scale = _scale;
+
+    for( uint32_t level = 1; level <= _data->atlas_mipmaps; ++level )
+    {
+        texpacker_atlas_t mipmap_dst;
+        texpacker_downsample_atlas( _data, _atlas, &mipmap_src, mipmap_scale, &mipmap_dst, 2 );
+
+        if( mipmap_src.pixels != _atlas->pixels )
+        {
+            free( mipmap_src.pixels );
+        }
+
+        wchar_t mipmap_path[FILENAME_MAX];
+        swprintf( mipmap_path, FILENAME_MAX, mipmap_path_format, (int)(atlas_path_ext - _atlas->path), _atlas->path, level, atlas_path_ext );
+
+        texpacker_palette_stats_t mipmap_palette;
+        if( texpacker_write_atlas_image( _data, mipmap_path, &mipmap_dst, &mipmap_palette ) != 0 )
+        {
+            free( mipmap_dst.pixels );
+
+            return 1;
+        }
+
+        mipmap_src.width = mipmap_dst.width;
+        mipmap_src.height = mipmap_dst.height;
+        mipmap_src.pixels = mipmap_dst.pixels;
+
+        mipmap_scale *= 2;
+    }
+
+    if( mipmap_src.pixels != _atlas->pixels )
+    {
+        free( mipmap_src.pixels );
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_get_scale_path( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas, uint32_t _scale, wchar_t * const _path )
+{
+    if( _scale == _data->atlas_scales_max )
+    {
+        wcscpy( _path, _atlas->path );
+
+        return;
+    }
+
+    const wchar_t * atlas_path_ext = wcsrchr( _atlas->path, L'.' );
+
+    if( atlas_path_ext == NULL )
+    {
+        atlas_path_ext = _atlas->path + wcslen( _atlas->path );
+    }
+
+    const wchar_t * scale_path_format = (_data->output_scale_path_format != NULL) ? _data->output_scale_path_format : L"%.*ls@%ux%ls";
+
+    swprintf( _path, FILENAME_MAX, scale_path_format, (int)(atlas_path_ext - _atlas->path), _atlas->path, _scale, atlas_path_ext );
+}
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_scale_job_t
+{
+    const texpacker_in_data_t * data;
+    const texpacker_atlas_t * atlas;
+    uint32_t scale;
+    int result;
+} texpacker_scale_job_t;
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_scale_worker( void * _ud )
+{
+    texpacker_scale_job_t * job = (texpacker_scale_job_t *)_ud;
+
+    const texpacker_in_data_t * data = job->data;
+
+    uint64_t trace_begin = texpacker_trace_begin( data );
+
+    uint32_t factor = data->atlas_scales_max / job->scale;
+
+    //rects are clamped while reducing, so sprites never pick up their neighbours
+    texpacker_atlas_t variant;
+    texpacker_downsample_atlas( data, job->atlas, job->atlas, 1, &variant, factor );
+
+    wchar_t variant_path[FILENAME_MAX];
+    texpacker_get_scale_path( data, job->atlas, job->scale, variant_path );
+
+    variant.path = variant_path;
+
+    job->result = 0;
+
+    if( texpacker_write_atlas_image( data, variant_path, &variant, &variant.palette ) != 0 )
+    {
+        job->result = 1;
+    }
+    else if( data->atlas_mipmaps != 0 )
+    {
+        job->result = texpacker_save_atlas_mipmaps( data, &variant, factor );
+    }
+
+    free( variant.pixels );
+
+    texpacker_trace_end( data, "scale", trace_begin, TEXPACKER_TRACE_NONE, job->atlas->index );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_save_atlas_scales( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas )
+{
+    texpacker_scale_job_t jobs[TEXPACKER_MAX_SCALES];
+    uint32_t jobs_count = 0;
+
+    for( uint32_t index = 0; index != _data->atlas_scales_count; ++index )
+    {
+        uint32_t scale = _data->atlas_scales[index];
+
+        if( scale == _data->atlas_scales_max )
+        {
+            continue;
+        }
+
+        texpacker_scale_job_t * job = jobs + jobs_count++;
+
+        job->data = _data;
+        job->atlas = _atlas;
+        job->scale = scale;
+        job->result = 0;
+    }
+
+    texpacker_run_parallel( &texpacker_scale_worker, jobs, sizeof( texpacker_scale_job_t ), jobs_count );
+
+    for( uint32_t index = 0; index != jobs_count; ++index )
+    {
+        if( jobs[index].result != 0 )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_save_atlas( texpacker_in_data_t * const _data, texpacker_atlas_t * _atlas, uint32_t _index )
+{
+    wchar_t output_path[FILENAME_MAX];
+
+    if( _index == 0 )
+    {
+        wcscpy( output_path, _data->output_atlas_path );
+    }
+    else
+    {
+        const wchar_t * output_path_format = (_data->output_atlas_path_format != NULL) ? _data->output_atlas_path_format : L"%.*s_%02u%s";
+        
+        swprintf( output_path, FILENAME_MAX, output_path_format, _data->output_atlas_path_ext - _data->output_atlas_path, _data->output_atlas_path, _index, _data->output_atlas_path_ext );
+    }
+
+    uint64_t trace_begin = texpacker_trace_begin( _data );
+
+    if( _data->output_strip_height != 0 )
+    {
+        if( texpacker_write_atlas_png_strips( _data, _atlas, output_path ) != 0 )
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        if( texpacker_write_atlas_image( _data, output_path, _atlas, &_atlas->palette ) != 0 )
+        {
+            return 1;
+        }
+    }
+
+    texpacker_trace_end( _data, "encode", trace_begin, TEXPACKER_TRACE_NONE, _index );
+
+    size_t atlas_path_size = wcslen( output_path ) + 1;
+
+    wchar_t * atlas_path = TEXPACKER_NEWN( wchar_t, atlas_path_size );
+    wcscpy( atlas_path, output_path );
+
+    free( _atlas->path );
+
+    _atlas->index = _index;
+    _atlas->path = atlas_path;
+
+    if( _data->atlas_mipmaps != 0 )
+    {
+        uint64_t mipmaps_begin = texpacker_trace_begin( _data );
+
+        if( texpacker_save_atlas_mipmaps( _data, _atlas, 1 ) != 0 )
+        {
+            return 1;
+        }
+
+        texpacker_trace_end( _data, "mipmaps", mipmaps_begin, TEXPACKER_TRACE_NONE, _index );
+    }
+
+    if( _data->atlas_scales_count != 0 )
+    {
+        if( texpacker_save_atlas_scales( _data, _atlas ) != 0 )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_ARRAY_MAGIC 0x414B5054U
+#define TEXPACKER_ARRAY_VERSION 1U
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_array_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channel;
+    uint32_t layers;
+} texpacker_array_header_t;
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_save_atlas_array( const texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlases, uint32_t _atlases_count )
+{
+    if( _atlases_count == 0 )
+    {
+        return 1;
+    }
+
+    const texpacker_atlas_t * atlas0 = _atlases[0];
+
+    texpacker_array_header_t header;
+    header.magic = TEXPACKER_ARRAY_MAGIC;
+    header.version = TEXPACKER_ARRAY_VERSION;
+    header.width = atlas0->width;
+    header.height = atlas0->height;
+    header.channel = atlas0->channel;
+    header.layers = _atlases_count;
+
+    for( uint32_t index = 0; index != _atlases_count; ++index )
+    {
+        const texpacker_atlas_t * atlas = _atlases[index];
+
+        if( atlas->width != header.width || atlas->height != header.height || atlas->pixels == NULL )
+        {
+            return 1;
+        }
+    }
+
+    FILE * f = _wfopen( _data->output_array_path, L"wb" );
+
+    if( f == NULL )
+    {
+        return 1;
+    }
+
+    if( fwrite( &header, sizeof( header ), 1, f ) != 1 )
+    {
+        fclose( f );
+
+        return 1;
+    }
+
+    size_t layer_size = (size_t)header.width * header.height * header.channel * sizeof( uint8_t );
+
+    for( uint32_t index = 0; index != _atlases_count; ++index )
+    {
+        const texpacker_atlas_t * atlas = _atlases[index];
+
+        if( fwrite( atlas->pixels, layer_size, 1, f ) != 1 )
+        {
+            fclose( f );
+
+            return 1;
+        }
+    }
+
+    fclose( f );
+
+    printf( "array: %u layers %ux%u [%u] %ls\n", header.layers, header.width, header.height, header.channel, _data->output_array_path );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_TILES_MAGIC 0x544B5054U
+#define TEXPACKER_TILES_VERSION 1U
+#define TEXPACKER_TILE_NONE (~0U)
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_tiles_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t gutter;
+    uint32_t pages;
+    uint32_t tiles;
+} texpacker_tiles_header_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_tiles_page_t
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t channel;
+    uint32_t columns;
+    uint32_t rows;
+} texpacker_tiles_page_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_tiles_entry_t
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t channel;
+} texpacker_tiles_entry_t;
+//////////////////////////////////////////////////////////////////////////
+typedef struct texpacker_tile_t
+{
+    uint64_t hash;
+    uint32_t atlas;
+    uint32_t cell;
+    uint32_t channel;
+
+    int png_len;
+    unsigned char * png;
+} texpacker_tile_t;
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_get_atlas_tiles_grid( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas, uint32_t * const _columns, uint32_t * const _rows )
+{
+    uint32_t size = _data->output_tiles_size;
+
+    *_columns = (_atlas->width + size - 1) / size;
+    *_rows = (_atlas->height + size - 1) / size;
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_copy_atlas_tile( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas, uint32_t _cell, uint8_t * _dst )
+{
+    uint32_t size = _data->output_tiles_size;
+    uint32_t gutter = _data->output_tiles_gutter;
+    uint32_t stride = size + gutter * 2;
+
+    uint32_t columns;
+    uint32_t rows;
+    texpacker_get_atlas_tiles_grid( _data, _atlas, &columns, &rows );
+
+    int64_t x0 = (int64_t)(_cell % columns) * size - gutter;
+    int64_t y0 = (int64_t)(_cell / columns) * size - gutter;
+
+    int64_t width = _atlas->width;
+    int64_t height = _atlas->height;
+    uint32_t pixel_size = _atlas->channel;
+
+    //the gutter and any part past the page edge repeat the nearest page pixel
+    int64_t span_begin = x0 < 0 ? 0 : x0;
+    int64_t span_end = x0 + stride > width ? width : x0 + stride;
+
+    uint32_t left = (uint32_t)(span_begin - x0);
+    uint32_t span = (uint32_t)(span_end - span_begin);
+    uint32_t right = stride - left - span;
+
+    for( uint32_t row = 0; row != stride; ++row )
+    {
+        int64_t y = y0 + row;
+        y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+
+        const uint8_t * atlas_row = texpacker_get_atlas_row( _atlas, (uint32_t)y );
+        uint8_t * tile_row = _dst + (size_t)row * stride * pixel_size;
+
+        texpacker_fill_pixels( tile_row, atlas_row, left, pixel_size );
+        memcpy( tile_row + left * pixel_size, atlas_row + span_begin * pixel_size, span * pixel_size );
+        texpacker_fill_pixels( tile_row + (left + span) * pixel_size, atlas_row + (width - 1) * pixel_size, right, pixel_size );
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_is_atlas_tile_empty( const texpacker_in_data_t * const _data, const texpacker_atlas_t * _atlas, uint32_t _cell )
+{
+    uint32_t pixel_size = _atlas->channel;
+
+    if( pixel_size != 2 && pixel_size != 4 )
+    {
+        return 0;
+    }
+
+    uint32_t size = _data->output_tiles_size;
+
+    uint32_t columns;
+    uint32_t rows;
+    texpacker_get_atlas_tiles_grid( _data, _atlas, &columns, &rows );
+
+    uint32_t x0 = (_cell % columns) * size;
+    uint32_t y0 = (_cell / columns) * size;
+    uint32_t x1 = x0 + size < _atlas->width ? x0 + size : _atlas->width;
+    uint32_t y1 = y0 + size < _atlas->height ? y0 + size : _atlas->height;
+
+    //only the tile itself decides, its gutter belongs to the neighbours
+    for( uint32_t y = y0; y != y1; ++y )
+    {
+        const uint8_t * atlas_row = texpacker_get_atlas_row( _atlas, y );
+
+        for( uint32_t x = x0; x != x1; ++x )
+        {
+            if( atlas_row[x * pixel_size + pixel_size - 1] != 0 )
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_collect_atlas_tiles( const texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlases, uint32_t _atlases_count, uint32_t * _cells, texpacker_tile_t * _tiles, uint32_t * _slots, uint32_t _slots_mask, uint32_t * const _tiles_count )
+{
+    uint32_t stride = _data->output_tiles_size + _data->output_tiles_gutter * 2;
+    size_t tile_bytes_max = (size_t)stride * stride * 4;
+
+    uint8_t * tile_pixels = TEXPACKER_NEWN( uint8_t, tile_bytes_max );
+    uint8_t * match_pixels = TEXPACKER_NEWN( uint8_t, tile_bytes_max );
+
+    uint32_t tiles_count = 0;
+    uint32_t empty_count = 0;
+    uint32_t duplicate_count = 0;
+
+    for( uint32_t index = 0; index != _atlases_count; ++index )
+    {
+        const texpacker_atlas_t * atlas = _atlases[index];
+
+        uint32_t columns;
+        uint32_t rows;
+        texpacker_get_atlas_tiles_grid( _data, atlas, &columns, &rows );
+
+        uint32_t channel = atlas->channel;
+        size_t tile_bytes = (size_t)stride * stride * channel;
+
+        for( uint32_t cell = 0; cell != columns * rows; ++cell )
+        {
+            uint32_t * cell_tile = _cells++;
+
+            if( texpacker_is_atlas_tile_empty( _data, atlas, cell ) == 1 )
+            {
+                *cell_tile = TEXPACKER_TILE_NONE;
+
+                ++empty_count;
+
+                continue;
+            }
+
+            texpacker_copy_atlas_tile( _data, atlas, cell, tile_pixels );
+
+            uint64_t hash = texpacker_cache_hash( tile_pixels, tile_bytes );
+
+            //the hash only narrows the search, a tile is shared when its pixels match exactly
+            uint32_t slot = (uint32_t)hash & _slots_mask;
+
+            for( ; _slots[slot] != TEXPACKER_TILE_NONE; slot = (slot + 1) & _slots_mask )
+            {
+                const texpacker_tile_t * tile = _tiles + _slots[slot];
+
+                if( tile->hash != hash || tile->channel != channel )
+                {
+                    continue;
+                }
+
+                texpacker_copy_atlas_tile( _data, _atlases[tile->atlas], tile->cell, match_pixels );
+
+                if( memcmp( tile_pixels, match_pixels, tile_bytes ) == 0 )
+                {
+                    break;
+                }
+            }
+
+            if( _slots[slot] != TEXPACKER_TILE_NONE )
+            {
+                *cell_tile = _slots[slot];
+
+                ++duplicate_count;
+
+                continue;
+            }
+
+            texpacker_tile_t * tile = _tiles + tiles_count;
+
+            tile->hash = hash;
+            tile->atlas = index;
+            tile->cell = cell;
+            tile->channel = channel;
+            tile->png = stbi_write_png_to_mem( tile_pixels, (int)(stride * channel), (int)stride, (int)stride, (int)channel, &tile->png_len );
+
+            if( tile->png == NULL )
+            {
+                *_tiles_count = tiles_count;
+
+                free( tile_pixels );
+                free( match_pixels );
+
+                return 1;
+            }
+
+            _slots[slot] = tiles_count;
+            *cell_tile = tiles_count;
+
+            ++tiles_count;
+        }
+    }
+
+    free( tile_pixels );
+    free( match_pixels );
+
+    *_tiles_count = tiles_count;
+
+    printf( "tiles: %u unique %u empty %u duplicate\n", tiles_count, empty_count, duplicate_count );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_write_atlas_tiles( const texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlases, uint32_t _atlases_count, const uint32_t * _cells, const texpacker_tile_t * _tiles, uint32_t _tiles_count )
+{
+    FILE * f = _wfopen( _data->output_tiles_path, L"wb" );
+
+    if( f == NULL )
+    {
+        return 1;
+    }
+
+    texpacker_tiles_header_t header;
+    header.magic = TEXPACKER_TILES_MAGIC;
+    header.version = TEXPACKER_TILES_VERSION;
+    header.size = _data->output_tiles_size;
+    header.gutter = _data->output_tiles_gutter;
+    header.pages = _atlases_count;
+    header.tiles = _tiles_count;
+
+    if( fwrite( &header, sizeof( header ), 1, f ) != 1 )
+    {
+        fclose( f );
+
+        return 1;
+    }
+
+    uint64_t offset = sizeof( header );
+
+    //each page maps its cells to tile entries, the entries point at the encoded tiles after them
+    for( uint32_t index = 0; index != _atlases_count; ++index )
+    {
+        const texpacker_atlas_t * atlas = _atlases[index];
+
+        texpacker_tiles_page_t page;
+        page.width = atlas->width;
+        page.height = atlas->height;
+        page.channel = atlas->channel;
+        texpacker_get_atlas_tiles_grid( _data, atlas, &page.columns, &page.rows );
+
+        uint32_t cells_count = page.columns * page.rows;
+
+        if( fwrite( &page, sizeof( page ), 1, f ) != 1 || fwrite( _cells, sizeof( uint32_t ), cells_count, f ) != cells_count )
+        {
+            fclose( f );
+
+            return 1;
+        }
+
+        _cells += cells_count;
+        offset += sizeof( page ) + (uint64_t)cells_count * sizeof( uint32_t );
+    }
+
+    offset += (uint64_t)_tiles_count * sizeof( texpacker_tiles_entry_t );
+
+    for( uint32_t index = 0; index != _tiles_count; ++index )
+    {
+        const texpacker_tile_t * tile = _tiles + index;
+
+        texpacker_tiles_entry_t entry;
+        entry.offset = offset;
+        entry.size = (uint32_t)tile->png_len;
+        entry.channel = tile->channel;
+
+        if( fwrite( &entry, sizeof( entry ), 1, f ) != 1 )
+        {
+            fclose( f );
+
+            return 1;
+        }
+
+        offset += entry.size;
+    }
+
+    for( uint32_t index = 0; index != _tiles_count; ++index )
+    {
+        const texpacker_tile_t * tile = _tiles + index;
+
+        if( fwrite( tile->png, (size_t)tile->png_len, 1, f ) != 1 )
+        {
+            fclose( f );
+
+            return 1;
+        }
+    }
+
+    fclose( f );
+
+    printf( "tiles: %u pages %u tiles %ux%u gutter %u %ls\n", header.pages, header.tiles, header.size, header.size, header.gutter, _data->output_tiles_path );
+
+    return 0;
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_save_atlas_tiles( const texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlases, uint32_t _atlases_count )
+{
+    uint32_t cells_count = 0;
+
+    for( uint32_t index = 0; index != _atlases_count; ++index )
+    {
+        const texpacker_atlas_t * atlas = _atlases[index];
+
+        if( atlas->pixels == NULL )
+        {
+            return 1;
+        }
+
+        uint32_t columns;
+        uint32_t rows;
+        texpacker_get_atlas_tiles_grid( _data, atlas, &columns, &rows );
+
+        cells_count += columns * rows;
+    }
+
+    uint32_t slots_count = 16;
+
+    while( slots_count < cells_count * 2 )
+    {
+        slots_count *= 2;
+    }
+
+    //every cell may hold a tile of its own, the extra one keeps empty sets allocated
+    uint32_t cells_capacity = cells_count + 1;
+
+    uint32_t * cells = TEXPACKER_NEWN( uint32_t, cells_capacity );
+    texpacker_tile_t * tiles = TEXPACKER_NEWN( texpacker_tile_t, cells_capacity );
+    uint32_t * slots = TEXPACKER_NEWN( uint32_t, slots_count );
+
+    for( uint32_t index = 0; index != slots_count; ++index )
+    {
+        slots[index] = TEXPACKER_TILE_NONE;
+    }
+
+    uint32_t tiles_count;
+    int res = texpacker_collect_atlas_tiles( _data, _atlases, _atlases_count, cells, tiles, slots, slots_count - 1, &tiles_count );
+
+    if( res == 0 )
+    {
+        res = texpacker_write_atlas_tiles( _data, _atlases, _atlases_count, cells, tiles, tiles_count );
+    }
+
+    for( uint32_t index = 0; index != tiles_count; ++index )
+    {
+        free( tiles[index].png );
+    }
+
+    free( slots );
+    free( tiles );
+    free( cells );
+
+    return res;
+}
+//////////////////////////////////////////////////////////////////////////
+static const char * texpacker_get_channel_format( uint32_t _channel )
+{
+    switch( _channel )
+    {
+    case 1:
+        {
+            return "l";
+        }
+    case 2:
+        {
+            return "la";
+        }
+    case 3:
+        {
+            return "rgb";
+        }
+    default:
+        {
+            return "rgba";
+        }
+    }
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_make_texture_tiles_info( const texpacker_in_data_t * const _data, const texpacker_texture_t * _texture, json_t * _j_texture )
+{
+    const texpacker_atlas_rect_t * atlas_rect = texpacker_get_texture_rect( _texture );
+
+    uint32_t size = _data->output_tiles_size;
+    uint32_t atlas_border = _data->atlas_border;
+
+    uint32_t columns;
+    uint32_t rows;
+    texpacker_get_atlas_tiles_grid( _data, _texture->atlas, &columns, &rows );
+
+    uint32_t x = atlas_rect->x + atlas_border;
+    uint32_t y = atlas_rect->y + atlas_border;
+    uint32_t w = atlas_rect->rotate == 0 ? _texture->width : _texture->height;
+    uint32_t h = atlas_rect->rotate == 0 ? _texture->height : _texture->width;
+
+    //cells are page row major, the page table of the tiles file maps them to tiles
+    json_t * j_tiles = json_array();
+
+    if( w != 0 && h != 0 )
+    {
+        for( uint32_t row = y / size; row <= (y + h - 1) / size; ++row )
+        {
+            for( uint32_t column = x / size; column <= (x + w - 1) / size; ++column )
+            {
+                json_array_append_new( j_tiles, json_integer( row * columns + column ) );
+            }
+        }
+    }
+
+    json_object_set_new( _j_texture, "tiles", j_tiles );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_make_texture_trim_info( const texpacker_texture_t * _texture, json_t * _j_texture )
+{
+    json_t * j_trim = json_object();
+
+    json_object_set_new( j_trim, "x", json_integer( _texture->trim_x ) );
+    json_object_set_new( j_trim, "y", json_integer( _texture->trim_y ) );
+    json_object_set_new( j_trim, "w", json_integer( _texture->source_width ) );
+    json_object_set_new( j_trim, "h", json_integer( _texture->source_height ) );
+
+    json_object_set_new( _j_texture, "trim", j_trim );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_make_texture_hull_info( const texpacker_in_data_t * const _data, const texpacker_texture_t * _texture, json_t * _j_texture )
+{
+    const texpacker_atlas_rect_t * atlas_rect = texpacker_get_texture_rect( _texture );
+
+    float atlas_x = (float)(atlas_rect->x + _data->atlas_border);
+    float atlas_y = (float)(atlas_rect->y + _data->atlas_border);
+
+    float atlas_width_inv = 1.f / (float)_texture->atlas->width;
+    float atlas_height_inv = 1.f / (float)_texture->atlas->height;
+
+    json_t * j_vertices = json_array();
+    json_t * j_uvs = json_array();
+
+    //vertices are in source pixels, uvs follow the texture into the atlas, transposed when rotated
+    for( uint32_t index = 0; index != _texture->hull_count; ++index )
+    {
+        const texpacker_hull_point_t * point = _texture->hull + index;
+
+        json_t * j_vertex = json_array();
+        json_array_append_new( j_vertex, json_real( point->x + (float)_texture->trim_x ) );
+        json_array_append_new( j_vertex, json_real( point->y + (float)_texture->trim_y ) );
+        json_array_append_new( j_vertices, j_vertex );
+
+        float u = atlas_rect->rotate == 0 ? point->x : point->y;
+        float v = atlas_rect->rotate == 0 ? point->y : point->x;
+
+        json_t * j_uv = json_array();
+        json_array_append_new( j_uv, json_real( (atlas_x + u) * atlas_width_inv ) );
+        json_array_append_new( j_uv, json_real( (atlas_y + v) * atlas_height_inv ) );
+        json_array_append_new( j_uvs, j_uv );
+    }
+
+    json_object_set_new( _j_texture, "vertices", j_vertices );
+    json_object_set_new( _j_texture, "uvs", j_uvs );
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_save_atlas_info( texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlases, uint32_t _atlases_count )
+{
+    json_t * j = json_object();
+
+    json_t * j_atlases = json_array();
+
+    for( uint32_t i = 0; i != _atlases_count; ++i )
+    {
+        texpacker_atlas_t * atlas = _atlases[i];
+
+        json_t * j_atlas = json_object();
+
+        char mbstr_atlas_path[FILENAME_MAX * 4];
+        texpacker_wchar_to_utf8( atlas->path, mbstr_atlas_path, sizeof( mbstr_atlas_path ) );
+
+        json_object_set_new( j_atlas, "path", json_string( mbstr_atlas_path ) );
+        json_object_set_new( j_atlas, "w", json_integer( atlas->width ) );
+        json_object_set_new( j_atlas, "h", json_integer( atlas->height ) );
+
+        if( _data->atlas_mipmaps != 0 )
+        {
+            json_object_set_new( j_atlas, "mipmaps", json_integer( _data->atlas_mipmaps ) );
+        }
+
+        if( _data->atlas_opaque_pages == 1 )
+        {
+            json_object_set_new( j_atlas, "format", json_string( texpacker_get_channel_format( atlas->channel ) ) );
+        }
+
+        if( _data->output_array_path != NULL )
+        {
+            json_object_set_new( j_atlas, "layer", json_integer( atlas->index ) );
+        }
+
+        if( _data->atlas_scales_count != 0 )
+        {
+            json_t * j_scales = json_array();
+
+            for( uint32_t index = 0; index != _data->atlas_scales_count; ++index )
+            {
+                uint32_t scale = _data->atlas_scales[index];
+                uint32_t factor = _data->atlas_scales_max / scale;
+
+                wchar_t scale_path[FILENAME_MAX];
+                texpacker_get_scale_path( _data, atlas, scale, scale_path );
+
+                char mbstr_scale_path[FILENAME_MAX * 4];
+                texpacker_wchar_to_utf8( scale_path, mbstr_scale_path, sizeof( mbstr_scale_path ) );
+
+                json_t * j_scale = json_object();
+
+                json_object_set_new( j_scale, "scale", json_integer( scale ) );
+                json_object_set_new( j_scale, "path", json_string( mbstr_scale_path ) );
+                json_object_set_new( j_scale, "w", json_integer( atlas->width / factor != 0 ? atlas->width / factor : 1 ) );
+                json_object_set_new( j_scale, "h", json_integer( atlas->height / factor != 0 ? atlas->height / factor : 1 ) );
+
+                json_array_append_new( j_scales, j_scale );
+            }
+
+            json_object_set_new( j_atlas, "scales", j_scales );
+        }
+
+        if( _data->output_palette == 1 )
+        {
+            json_t * j_palette = json_object();
+
+            json_object_set_new( j_palette, "colors", json_integer( atlas->palette.colors ) );
+            json_object_set_new( j_palette, "exact", json_boolean( atlas->palette.exact ) );
+            json_object_set_new( j_palette, "rmse", json_real( atlas->palette.rmse ) );
+            json_object_set_new( j_palette, "max_error", json_integer( atlas->palette.max_error ) );
+
+            json_object_set_new( j_atlas, "palette", j_palette );
+        }
+
+        if( _data->output_tiles_path != NULL )
+        {
+            uint32_t columns;
+            uint32_t rows;
+            texpacker_get_atlas_tiles_grid( _data, atlas, &columns, &rows );
+
+            json_object_set_new( j_atlas, "columns", json_integer( columns ) );
+            json_object_set_new( j_atlas, "rows", json_integer( rows ) );
+        }
+
+        json_array_append_new( j_atlases, j_atlas );
+    }
+
+    json_object_set_new( j, "atlases", j_atlases );
+
+    if( _data->output_array_path != NULL && _atlases_count != 0 )
+    {
+        json_t * j_array = json_object();
+
+        char mbstr_array_path[FILENAME_MAX * 4];
+        texpacker_wchar_to_utf8( _data->output_array_path, mbstr_array_path, sizeof( mbstr_array_path ) );
+
+        json_object_set_new( j_array, "path", json_string( mbstr_array_path ) );
+        json_object_set_new( j_array, "w", json_integer( _atlases[0]->width ) );
+        json_object_set_new( j_array, "h", json_integer( _atlases[0]->height ) );
+        json_object_set_new( j_array, "channels", json_integer( _atlases[0]->channel ) );
+        json_object_set_new( j_array, "layers", json_integer( _atlases_count ) );
+
+        json_object_set_new( j, "array", j_array );
+    }
+
+    if( _data->output_tiles_path != NULL )
+    {
+        json_t * j_tiles = json_object();
+
+        char mbstr_tiles_path[FILENAME_MAX * 4];
+        texpacker_wchar_to_utf8( _data->output_tiles_path, mbstr_tiles_path, sizeof( mbstr_tiles_path ) );
+
+        json_object_set_new( j_tiles, "path", json_string( mbstr_tiles_path ) );
+        json_object_set_new( j_tiles, "size", json_integer( _data->output_tiles_size ) );
+        json_object_set_new( j_tiles, "gutter", json_integer( _data->output_tiles_gutter ) );
+
+        json_object_set_new( j, "tiles", j_tiles );
+    }
+
+    json_t * j_textures = json_array();
+
+    uint32_t textures_count = _data->textures_count;
+
+    //textures are listed in packing order
+    for( uint32_t i = 0; i != textures_count; ++i )
+    {
+        const texpacker_texture_t * texture = _data->textures + _data->pack->order[i];
+
+        const texpacker_atlas_rect_t * atlas_rect = texpacker_get_texture_rect( texture );
+
+        json_t * j_texture = json_object();
+
+        json_object_set_new( j_texture, "path", json_string( texpacker_get_string( _data, texture->path ) ) );
+        json_object_set_new( j_texture, "atlas", json_integer( texture->atlas->index ) );
+
+        if( texture->group != TEXPACKER_GROUP_NONE )
+        {
+            json_object_set_new( j_texture, "group", json_string( texpacker_get_string( _data, _data->groups[texture->group] ) ) );
+        }
+
+        //renderers can take a cheaper path for sprites on pages without alpha
+        if( _data->atlas_opaque_pages == 1 )
+        {
+            json_object_set_new( j_texture, "format", json_string( texpacker_get_channel_format( texture->atlas->channel ) ) );
+        }
+
+        if( _data->output_array_path != NULL )
+        {
+            json_object_set_new( j_texture, "layer", json_integer( texture->atlas->index ) );
+        }
+
+        uint32_t atlas_border = _data->atlas_border;
+
+        float atlas_width_inv = 1.f / (float)texture->atlas->width;
+        float atlas_height_inv = 1.f / (float)texture->atlas->height;
+
+        float uv_x = (float)(atlas_rect->x + atlas_border) * atlas_width_inv;
+        float uv_y = (float)(atlas_rect->y + atlas_border) * atlas_height_inv;
+        float uv_u = (float)(atlas_rect->u - atlas_border) * atlas_width_inv;
+        float uv_v = (float)(atlas_rect->v - atlas_border) * atlas_height_inv;
+
+        json_object_set_new( j_texture, "x", json_real( uv_x ) );
+        json_object_set_new( j_texture, "y", json_real( uv_y ) );
+        json_object_set_new( j_texture, "u", json_real( uv_u ) );
+        json_object_set_new( j_texture, "v", json_real( uv_v ) );
+
+        //the pixel rect lets a later run cut the texture back out of this atlas
+        json_t * j_rect = json_object();
+
+        json_object_set_new( j_rect, "x", json_integer( atlas_rect->x + atlas_border ) );
+        json_object_set_new( j_rect, "y", json_integer( atlas_rect->y + atlas_border ) );
+        json_object_set_new( j_rect, "w", json_integer( atlas_rect->rotate == 0 ? texture->width : texture->height ) );
+        json_object_set_new( j_rect, "h", json_integer( atlas_rect->rotate == 0 ? texture->height : texture->width ) );
+
+        json_object_set_new( j_texture, "rect", j_rect );
+
+        if( _data->output_tiles_path != NULL )
+        {
+            texpacker_make_texture_tiles_info( _data, texture, j_texture );
+        }
+
+        if( atlas_rect->rotate == 1 )
+        {
+            json_object_set_new( j_texture, "rotate", json_true() );
+        }
+
+        //textures repacked from a trimmed atlas keep their trim even without a hull
+        if( _data->atlas_hull_trim == 1 || texture->sheet_source_width != 0 )
+        {
+            texpacker_make_texture_trim_info( texture, j_texture );
+        }
+
+        if( _data->atlas_hull_vertices != 0 )
+        {
+            texpacker_make_texture_hull_info( _data, texture, j_texture );
+        }
+
+        json_array_append_new( j_textures, j_texture );
+    }
+
+    json_object_set_new( j, "textures", j_textures );
+    
+    FILE * f = _wfopen( _data->output_atlas_info, L"wb" );
+
+    if( f == NULL )
     {
-        _r->u = th;
-        _r->v = tw;
+        return 1;
     }
 
-    _r->state |= 0x00000001;
-    _r->rotate = _rotate;
-
-    uint32_t x = _r->x;
-    uint32_t y = _r->y;
+    int res = json_dumpf( j, f, JSON_INDENT( 2 ) );
 
-    uint32_t u = _r->u;
-    uint32_t v = _r->v;
+    json_decref( j );
 
-    uint32_t w = _r->w;
-    uint32_t h = _r->h;
+    fclose( f );
 
-    _r->l[0] = texpacker_make_atlas_rect( x, y + v, w, h - v );
-    _r->l[1] = texpacker_make_atlas_rect( x + u, y, w - u, v );
-    _r->l[2] = texpacker_make_atlas_rect( x, y + v, u, h - v );
-    _r->l[3] = texpacker_make_atlas_rect( x + u, y, w - u, h );
+    if( res != 0 )
+    {
+        return 1;
+    }
 
     return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-static int texpacker_mark_atlas_rect( texpacker_atlas_rect_t * _r, texpacker_atlas_rect_t * _mr )
+static void texpacker_report_groups( const texpacker_in_data_t * const _data )
 {
-    if( _r == _mr )
+    if( _data->groups_count == 0 )
     {
-        return 0;
+        return;
     }
 
-    if( _r->state == 0 )
+    const texpacker_pack_state_t * pack = _data->pack;
+
+    uint32_t * group_pages = pack->group_cursor;
+    uint8_t * group_split = (uint8_t *)calloc( _data->groups_count, sizeof( uint8_t ) );
+
+    for( uint32_t group = 0; group != _data->groups_count; ++group )
     {
-        return -1;
+        group_pages[group] = TEXPACKER_PAGE_NONE;
     }
 
-    const uint32_t masks[4] = {
-        (0x00000010 | 0x00000100),
-        (0x00000020 | 0x00000100),
-        (0x00000040 | 0x00000200),
-        (0x00000080 | 0x00000200)
-    };
-
-    for( uint32_t index = 0; index != 4; ++index )
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
     {
-        texpacker_atlas_rect_t * rp = _r->l[index];
+        uint32_t group = pack->group[index];
 
-        if( rp == _mr )
+        if( group == TEXPACKER_GROUP_NONE )
         {
-            _r->state |= masks[index];
+            continue;
+        }
 
-            return 0;
+        if( group_pages[group] == TEXPACKER_PAGE_NONE )
+        {
+            group_pages[group] = pack->page[index];
         }
-        else
+        else if( group_pages[group] != pack->page[index] )
         {
-            if( texpacker_mark_atlas_rect( rp, _mr ) == 0 )
-            {
-                return 0;
-            }
+            group_split[group] = 1;
         }
     }
 
-    return -1;
-}
-//////////////////////////////////////////////////////////////////////////
-typedef struct texpacker_atlas_rect_desc_t
-{
-    texpacker_atlas_rect_t * r;
-    int8_t rotate;
-} texpacker_atlas_rect_desc_t;
-//////////////////////////////////////////////////////////////////////////
-static int texpacker_find_atlas_rects( uint32_t _border, texpacker_atlas_rect_t * _r, texpacker_texture_t * _t, texpacker_atlas_rect_desc_t * _nr, uint32_t * const _count )
-{
-    uint32_t w = _t->width + _border * 2;
-    uint32_t h = _t->height + _border * 2;
+    uint32_t groups_split = 0;
 
-    switch( _r->state & 0x0000000F )
+    for( uint32_t group = 0; group != _data->groups_count; ++group )
     {
-    case 0:
+        if( group_split[group] == 0 )
         {
-            if( _r->w >= w && _r->h >= h )
-            {
-                texpacker_atlas_rect_desc_t desc;
-                desc.r = _r;
-                desc.rotate = 0;
-
-                _nr[(*_count)++] = desc;
-            }
-            else if( _r->w >= h && _r->h >= w )
-            {
-                texpacker_atlas_rect_desc_t desc;
-                desc.r = _r;
-                desc.rotate = 1;
+            continue;
+        }
 
-                _nr[(*_count)++] = desc;
-            }
-            else
-            {
-                return 0;
-            }
-        }break;
-    case 1:
-        {
-            uint32_t begin_index = 0;
-            uint32_t end_index = 0;
+        printf( "group: %s split across pages\n", texpacker_get_string( _data, _data->groups[group] ) );
 
-            switch( _r->state & 0x00000F00 )
-            {
-            case 0x00000000:
-                {
-                    begin_index = 0;
-                    end_index = 4;
-                }break;
-            case 0x00000100:
-                {
-                    begin_index = 0;
-                    end_index = 2;
-                }break;
-            case 0x00000200:
-                {
-                    begin_index = 2;
-                    end_index = 4;
-                }break;
-            }
+        ++groups_split;
+    }
 
-            for( uint32_t index = begin_index; index != end_index; ++index )
-            {
-                texpacker_atlas_rect_t * rl = _r->l[index];
+    free( group_split );
 
-                if( texpacker_find_atlas_rects( _border, rl, _t, _nr, _count ) != 0 )
-                {
-                    return 1;
-                }
-            }
+    printf( "groups: %u groups %u split\n", _data->groups_count, groups_split );
+}
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_apply_effort( texpacker_in_data_t * const _data )
+{
+    switch( _data->atlas_effort )
+    {
+    case TEXPACKER_EFFORT_FAST:
+        {
+            _data->atlas_heuristics = 1;
+            _data->atlas_multi_bin = 0;
         }break;
-    case 2:
+    case TEXPACKER_EFFORT_DEFAULT:
         {
-            //dummy
-
-            return 0;
         }break;
-    default:
-        return 1;
-        break;
+    case TEXPACKER_EFFORT_MAX:
+        {
+            _data->atlas_heuristics = 0;
+            _data->atlas_multi_bin = 1;
+        }break;
     }
-
-    return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-static uint32_t __new_pow2( uint32_t x )
+static int texpacker_build_atlases( texpacker_in_data_t * const _data, texpacker_atlas_t *** const _atlases, uint32_t * const _atlases_count )
 {
-    x--;
-    x |= x >> 1;
-    x |= x >> 2;
-    x |= x >> 4;
-    x |= x >> 8;
-    x |= x >> 16;
-    x++;
+    //multi bin narrows the caps of the copy, so a rebuild starts from the configured ones
+    texpacker_in_data_t build_data = *_data;
 
-    return x;
-}
-//////////////////////////////////////////////////////////////////////////
-static void texpacker_get_texture_bounds_pow2( const texpacker_in_data_t * const _data, uint32_t * const _width, uint32_t * const _height )
-{
-    uint32_t max_width = 0;
-    uint32_t max_height = 0;
+    build_data.atlas_time_begin = texpacker_get_time_ms();
 
-    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    texpacker_prepare_pack_state( &build_data );
+
+    uint64_t sort_begin = texpacker_trace_begin( &build_data );
+
+    if( texpacker_load_texures_sort( &build_data ) != 0 )
     {
-        const texpacker_texture_t * t = _data->textures + index;
+        return 1;
+    }
+
+    texpacker_trace_end( &build_data, "sort", sort_begin, TEXPACKER_TRACE_NONE, TEXPACKER_TRACE_NONE );
 
-        max_width = t->width > max_width ? t->width : max_width;
-        max_height = t->height > max_height ? t->height : max_height;
+    uint64_t balance_begin = texpacker_trace_begin( &build_data );
+
+    if( texpacker_balance_atlases( &build_data ) != 0 )
+    {
+        return 1;
     }
 
-    uint32_t max_width_border = max_width + _data->atlas_border * 2;
-    uint32_t max_height_border = max_height + _data->atlas_border * 2;
+    texpacker_trace_end( &build_data, "balance", balance_begin, TEXPACKER_TRACE_NONE, TEXPACKER_TRACE_NONE );
 
-    *_width = __new_pow2( max_width_border );
-    *_height = __new_pow2( max_height_border );
-}
-//////////////////////////////////////////////////////////////////////////
-static int texpacker_probe_atlas_rect( uint32_t _width, uint32_t _height, const texpacker_in_data_t * const _data, texpacker_atlas_rect_t ** _rect, uint32_t * const _packaged, uint32_t * const _unpackaged )
-{
-    uint32_t atlas_border = _data->atlas_border;
+    texpacker_atlas_t ** atlases = NULL;
+    uint32_t atlases_capacity = 0;
+    uint32_t atlases_count = 0;
 
-    texpacker_atlas_rect_t * rect = texpacker_make_atlas_rect( 0, 0, _width, _height );
+    *_atlases = NULL;
+    *_atlases_count = 0;
 
-    uint32_t packaged = 0;
-    uint32_t unpackaged = 0;
+    texpacker_reset_pack_state( &build_data );
 
-    for( uint32_t index = 0; index != _data->textures_count; ++index )
+    for( uint32_t index = 0;; ++index )
     {
-        texpacker_texture_t * t = _data->textures + index;
-
-        if( t->atlas != NULL )
+        if( atlases_count == atlases_capacity )
         {
-            continue;
-        }
+            atlases_capacity = atlases_capacity != 0 ? atlases_capacity * 2 : 16;
 
-        if( t->atlas_rect != NULL )
-        {
-            continue;
+            atlases = (texpacker_atlas_t **)realloc( atlases, atlases_capacity * sizeof( texpacker_atlas_t * ) );
+
+            *_atlases = atlases;
         }
 
-        texpacker_atlas_rect_desc_t nr[2048] = {NULL};
-        uint32_t nr_count = 0;
-        if( texpacker_find_atlas_rects( atlas_border, rect, t, nr, &nr_count ) != 0 )
+        texpacker_in_data_t tail_data;
+        const texpacker_in_data_t * page_data = texpacker_get_page_data( &build_data, &tail_data );
+
+        texpacker_atlas_t * atlas;
+        uint32_t packaged;
+        uint32_t unpackaged;
+        if( texpacker_make_atlas( page_data, &atlas, &packaged, &unpackaged ) != 0 )
         {
             return 1;
         }
 
-        uint32_t density = ~0U;
-        const texpacker_atlas_rect_desc_t * df = NULL;
+        //if( texpacker_correct_pixels_atlas( atlas, index ) != 0 )
 
-        for( uint32_t nr_index = 0; nr_index != nr_count; ++nr_index )
+        if( texpacker_save_atlas( &build_data, atlas, index ) != 0 )
         {
-            const texpacker_atlas_rect_desc_t * d = nr + nr_index;
-
-            const texpacker_atlas_rect_t * r = d->r;
-            int8_t rotate = d->rotate;
-
-            uint32_t w = t->width + atlas_border * 2;
-            uint32_t h = t->height + atlas_border * 2;
+            return 1;
+        }
 
-            uint32_t tw = rotate == 0 ? w : h;
-            uint32_t th = rotate == 0 ? h : w;
+        atlases[index] = atlas;
+        ++atlases_count;
 
-            uint32_t dw = r->w - tw;
-            uint32_t dh = r->h - th;
-            uint32_t dwh = dw * th + dh * tw + dw * dh;
+        *_atlases_count = atlases_count;
 
-            if( dwh < density )
-            {
-                density = dwh;
-                df = d;
-            }
+        if( unpackaged == 0 )
+        {
+            break;
         }
+    }
 
-        if( df == NULL )
+    for( uint32_t i = 0; i != build_data.textures_count; ++i )
+    {
+        if( build_data.pack->page[i] == TEXPACKER_PAGE_NONE )
         {
-            ++unpackaged;
-
-            continue;
+            return 1;
         }
+    }
 
-        ++packaged;
-
-        printf( "texture: %ls density %u\n", t->path, density );
+    texpacker_report_groups( &build_data );
 
-        texpacker_atlas_rect_t * rf = df->r;
-        int8_t rotatef = df->rotate;
+    if( build_data.output_array_path != NULL )
+    {
+        uint64_t array_begin = texpacker_trace_begin( &build_data );
 
-        if( texpacker_fill_atlas_rect( atlas_border, rf, rotatef, t ) != 0 )
+        if( texpacker_save_atlas_array( &build_data, atlases, atlases_count ) != 0 )
         {
             return 1;
         }
 
-        if( texpacker_mark_atlas_rect( rect, rf ) != 0 )
+        texpacker_trace_end( &build_data, "write array", array_begin, TEXPACKER_TRACE_NONE, TEXPACKER_TRACE_NONE );
+    }
+
+    if( build_data.output_tiles_path != NULL )
+    {
+        uint64_t tiles_begin = texpacker_trace_begin( &build_data );
+
+        if( texpacker_save_atlas_tiles( &build_data, atlases, atlases_count ) != 0 )
         {
             return 1;
         }
 
-        t->atlas_rect = rf;
+        texpacker_trace_end( &build_data, "write tiles", tiles_begin, TEXPACKER_TRACE_NONE, TEXPACKER_TRACE_NONE );
     }
 
-    *_rect = rect;
-    *_packaged = packaged;
-    *_unpackaged = unpackaged;
+    uint64_t info_begin = texpacker_trace_begin( &build_data );
+
+    if( texpacker_save_atlas_info( &build_data, atlases, atlases_count ) != 0 )
+    {
+        return 1;
+    }
+
+    texpacker_trace_end( &build_data, "write info", info_begin, TEXPACKER_TRACE_NONE, TEXPACKER_TRACE_NONE );
 
     return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-static void texpacker_render_rect_border( texpacker_atlas_t * _atlas, uint32_t _x, uint32_t _y, uint32_t _w, uint32_t _h, uint8_t _r, uint8_t _g, uint8_t _b, uint8_t _a )
+static void texpacker_free_atlas( texpacker_atlas_t * _atlas )
 {
-    uint32_t x = _x;
-    uint32_t y = _y;
-
-    uint32_t w = _w;
-    uint32_t h = _h;
-
-    uint32_t width = _atlas->width;
-
-    uint8_t * atlas_pixels_byte = (uint8_t *)_atlas->pixels;
-    uint32_t atlas_pixel_size = _atlas->channel;
-
-    uint32_t pitch = width * atlas_pixel_size;
-
-    uint8_t rgba[] = {_r, _g, _b, _a};
-
-    for( uint32_t index = 0; index != w; ++index )
-    {
-        memcpy( atlas_pixels_byte + x * atlas_pixel_size + y * pitch + index * atlas_pixel_size, rgba, atlas_pixel_size );
-    }
+    free( _atlas->rects );
+    free( _atlas->pixels );
+    free( _atlas->path );
+    free( _atlas );
+}
+//////////////////////////////////////////////////////////////////////////
+#define TEXPACKER_WATCH_POLL_MS 100
+#define TEXPACKER_WATCH_DEBOUNCE_POLLS 3
+//////////////////////////////////////////////////////////////////////////
+static void texpacker_sleep( uint32_t _ms )
+{
+#ifdef _WIN32
+    Sleep( _ms );
+#else
+    usleep( _ms * 1000 );
+#endif
+}
+//////////////////////////////////////////////////////////////////////////
+static int texpacker_stat_file( const texpacker_in_data_t * const _data, uint32_t _path, uint64_t * const _time, uint64_t * const _size )
+{
+    const char * path = texpacker_get_string( _data, _path );
 
-    for( uint32_t index = 0; index != w; ++index )
+    wchar_t texture_path[FILENAME_MAX];
+    if( texpacker_utf8_to_wchar( path, strlen( path ), texture_path, FILENAME_MAX ) != 0 )
     {
-        memcpy( atlas_pixels_byte + x * atlas_pixel_size + y * pitch + index * atlas_pixel_size + (h - 1) * pitch, rgba, atlas_pixel_size );
+        return 1;
     }
 
-    for( uint32_t index = 0; index != h; ++index )
-    {
-        memcpy( atlas_pixels_byte + x * atlas_pixel_size + y * pitch + index * pitch, rgba, atlas_pixel_size );
-    }
+    struct _stat st;
 
-    for( uint32_t index = 0; index != h; ++index )
+    if( _wstat( texture_path, &st ) != 0 )
     {
-        memcpy( atlas_pixels_byte + x * atlas_pixel_size + y * pitch + index * pitch + (w - 1) * atlas_pixel_size, rgba, atlas_pixel_size );
+        return 1;
     }
-}
-//////////////////////////////////////////////////////////////////////////
-static void texpacker_render_atlas_border( uint32_t _border, texpacker_atlas_t * _atlas, const texpacker_texture_t * _texture, uint8_t _r, uint8_t _g, uint8_t _b, uint8_t _a )
-{
-    uint32_t x = _texture->atlas_rect->x + _border;
-    uint32_t y = _texture->atlas_rect->y + _border;
 
-    uint32_t w = _texture->atlas_rect->u - _border * 2;
-    uint32_t h = _texture->atlas_rect->v - _border * 2;
+    *_time = (uint64_t)st.st_mtime;
+    *_size = (uint64_t)st.st_size;
 
-    texpacker_render_rect_border( _atlas, x, y, w, h, _r, _g, _b, _a );
+    return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-static void texpacker_render_atlas( const texpacker_in_data_t * const _data, texpacker_atlas_t * _atlas )
+static uint32_t texpacker_watch_poll( texpacker_in_data_t * const _data )
 {
-    uint32_t atlas_border = _data->atlas_border;
-    
-    uint32_t atlas_width = _atlas->width;
-    uint32_t atlas_pixel_size = _atlas->channel * sizeof( uint8_t );
-    uint8_t * altas_pixels_byte = (uint8_t *)_atlas->pixels;
+    uint32_t changed = 0;
 
-    for( uint32_t texture_index = 0; texture_index != _data->textures_count; ++texture_index )
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
     {
-        texpacker_texture_t * texture = _data->textures + texture_index;
+        texpacker_texture_t * texture = _data->textures + index;
 
-        if( texture->atlas != NULL )
+        if( texture->sheet != TEXPACKER_SHEET_NONE )
         {
             continue;
         }
 
-        texpacker_atlas_rect_t * atlas_rect = texture->atlas_rect;
-
-        if( atlas_rect == NULL )
+        uint64_t file_time;
+        uint64_t file_size;
+        if( texpacker_stat_file( _data, texture->path, &file_time, &file_size ) != 0 )
         {
             continue;
         }
 
-        uint32_t ax = atlas_rect->x + atlas_border;
-        uint32_t ay = atlas_rect->y + atlas_border;
+        if( texture->file_time == file_time && texture->file_size == file_size )
+        {
+            continue;
+        }
 
-        uint32_t tw = texture->width;
-        uint32_t th = texture->height;
-        
-        uint8_t * texture_pixels_byte = (uint8_t *)texture->pixels;
-        uint32_t texture_pixel_size = texture->channel * sizeof( uint8_t );
-        uint32_t texture_row_size = tw * texture_pixel_size;
+        texture->file_time = file_time;
+        texture->file_size = file_size;
+        texture->file_dirty = 1;
 
-        if( atlas_rect->rotate == 0 )
-        {
-            uint32_t u = tw;
-            uint32_t v = th;
+        ++changed;
+    }
 
-            if( atlas_pixel_size == 4 && texture_pixel_size == 4 )
-            {
-                for( uint32_t v_index = 0; v_index != v; ++v_index )
-                {
-                    memcpy( altas_pixels_byte + (ax + (ay + v_index) * atlas_width) * atlas_pixel_size, texture_pixels_byte + v_index * texture_row_size, texture_row_size );
-                }
-            }
-            else if( atlas_pixel_size == 4 && texture_pixel_size == 3 )
-            {
-                for( uint32_t u_index = 0; u_index != u; ++u_index )
-                {
-                    for( uint32_t v_index = 0; v_index != v; ++v_index )
-                    {
-                        uint32_t atlas_offset = (ax + u_index + (ay + v_index) * atlas_width) * atlas_pixel_size;
-                        uint32_t texture_offset = (u_index + v_index * tw) * texture_pixel_size;
+    //a changed sheet dirties every texture cut from it
+    for( uint32_t index = 0; index != _data->sheets_count; ++index )
+    {
+        texpacker_sheet_t * sheet = _data->sheets + index;
 
-                        *(altas_pixels_byte + atlas_offset + 0) = *(texture_pixels_byte + texture_offset + 0);
-                        *(altas_pixels_byte + atlas_offset + 1) = *(texture_pixels_byte + texture_offset + 1);
-                        *(altas_pixels_byte + atlas_offset + 2) = *(texture_pixels_byte + texture_offset + 2);
-                        *(altas_pixels_byte + atlas_offset + 3) = 255;
-                    }
-                }
-            }
+        uint64_t file_time;
+        uint64_t file_size;
+        if( texpacker_stat_file( _data, sheet->path, &file_time, &file_size ) != 0 )
+        {
+            continue;
         }
-        else
+
+        if( sheet->file_time == file_time && sheet->file_size == file_size )
         {
-            uint32_t u = th;
-            uint32_t v = tw;
+            continue;
+        }
 
-            if( atlas_pixel_size == 4 && texture_pixel_size == 4 )
-            {
-                for( uint32_t u_index = 0; u_index != u; ++u_index )
-                {
-                    for( uint32_t v_index = 0; v_index != v; ++v_index )
-                    {
-                        uint32_t atlas_offset = (ax + u_index + (ay + v_index) * atlas_width) * atlas_pixel_size;
-                        uint32_t texture_offset = (v_index + u_index * tw) * texture_pixel_size;
+        sheet->file_time = file_time;
+        sheet->file_size = file_size;
+        sheet->file_dirty = 1;
 
-                        *(altas_pixels_byte + atlas_offset + 0) = *(texture_pixels_byte + texture_offset + 0);
-                        *(altas_pixels_byte + atlas_offset + 1) = *(texture_pixels_byte + texture_offset + 1);
-                        *(altas_pixels_byte + atlas_offset + 2) = *(texture_pixels_byte + texture_offset + 2);
-                        *(altas_pixels_byte + atlas_offset + 3) = *(texture_pixels_byte + texture_offset + 3);
-                    }
-                }
-            }
-            else if( atlas_pixel_size == 4 && texture_pixel_size == 3 )
+        for( uint32_t texture_index = 0; texture_index != _data->textures_count; ++texture_index )
+        {
+            texpacker_texture_t * texture = _data->textures + texture_index;
+
+            if( texture->sheet == index )
             {
-                for( uint32_t u_index = 0; u_index != u; ++u_index )
-                {
-                    for( uint32_t v_index = 0; v_index != v; ++v_index )
-                    {
-                        uint32_t atlas_offset = (ax + u_index + (ay + v_index) * atlas_width) * atlas_pixel_size;
-                        uint32_t texture_offset = (v_index + u_index * tw) * texture_pixel_size;
+                texture->file_dirty = 1;
 
-                        *(altas_pixels_byte + atlas_offset + 0) = *(texture_pixels_byte + texture_offset + 0);
-                        *(altas_pixels_byte + atlas_offset + 1) = *(texture_pixels_byte + texture_offset + 1);
-                        *(altas_pixels_byte + atlas_offset + 2) = *(texture_pixels_byte + texture_offset + 2);
-                        *(altas_pixels_byte + atlas_offset + 3) = 255;
-                    }
-                }
+                ++changed;
             }
         }
-
-        texpacker_render_atlas_border( atlas_border, _atlas, texture, 255, 0, 0, 255 );
-
-        texture->atlas = _atlas;
     }
 
-    texpacker_render_rect_border( _atlas, 0, 0, _atlas->width, _atlas->height, 255, 0, 0, 255 );
+    return changed;
 }
 //////////////////////////////////////////////////////////////////////////
-static void texpacker_correct_atlas_alpha_pixel( uint32_t _u, uint32_t _v, texpacker_atlas_t * _atlas, uint32_t * const _tr, uint32_t * const _tg, uint32_t * const _tb, uint32_t * const _count )
+static int texpacker_watch_update( texpacker_in_data_t * const _data, texpacker_atlas_t *** const _atlases, uint32_t * const _atlases_count )
 {
-    uint32_t atlas_width = _atlas->width;
-    uint32_t atlas_height = _atlas->height;
+    uint32_t repack = 0;
+    uint32_t reloaded = 0;
 
-    if( _u >= atlas_width || _v >= atlas_height )
+    uint8_t * atlases_dirty = (uint8_t *)calloc( *_atlases_count + 1, sizeof( uint8_t ) );
+
+    //old sheet pixels stay alive until every view has moved to the new ones
+    void ** sheets_stale = (void **)calloc( _data->sheets_count + 1, sizeof( void * ) );
+
+    for( uint32_t index = 0; index != _data->sheets_count; ++index )
     {
-        return;
-    }
+        texpacker_sheet_t * sheet = _data->sheets + index;
 
-    uint32_t atlas_pixel_size = _atlas->channel * sizeof( uint8_t );
-    uint8_t * altas_pixels_byte = (uint8_t *)_atlas->pixels;
+        if( sheet->file_dirty == 0 )
+        {
+            continue;
+        }
+
+        sheet->file_dirty = 0;
+
+        void * pixels;
+        uint32_t cache_hits = 0;
+        uint32_t cache_unwritten = 0;
+        if( texpacker_load_sheet_pixels( _data, NULL, sheet, &pixels, &cache_hits, &cache_unwritten ) != 0 )
+        {
+            printf( "watch: unable to load sheet %s\n", texpacker_get_string( _data, sheet->path ) );
 
-    uint32_t atlas_pixel_offset = (_u + _v * atlas_width) * atlas_pixel_size;
+            continue;
+        }
 
-    uint32_t atlas_pixel_probe_a = *(altas_pixels_byte + atlas_pixel_offset + 3);
+        sheets_stale[index] = sheet->pixels;
+        sheet->pixels = pixels;
+    }
 
-    if( atlas_pixel_probe_a == 0 )
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
     {
-        return;
-    }
+        texpacker_texture_t * texture = _data->textures + index;
 
-    uint32_t atlas_pixel_probe_r = *(altas_pixels_byte + atlas_pixel_offset + 0);
-    uint32_t atlas_pixel_probe_g = *(altas_pixels_byte + atlas_pixel_offset + 1);
-    uint32_t atlas_pixel_probe_b = *(altas_pixels_byte + atlas_pixel_offset + 2);
+        if( texture->file_dirty == 0 )
+        {
+            continue;
+        }
 
-    *_tr += atlas_pixel_probe_r;
-    *_tg += atlas_pixel_probe_g;
-    *_tb += atlas_pixel_probe_b;
+        texture->file_dirty = 0;
 
-    *_count += 1;
-}
-//////////////////////////////////////////////////////////////////////////
-static void texpacker_correct_atlas_alpha_pixels( texpacker_atlas_t * _atlas )
-{
-    uint32_t atlas_width = _atlas->width;
-    uint32_t atlas_height = _atlas->height;
-    uint32_t atlas_pixel_size = _atlas->channel * sizeof( uint8_t );
-    uint8_t * altas_pixels_byte = (uint8_t *)_atlas->pixels;
+        texpacker_texture_t reload = *texture;
 
-    if( atlas_pixel_size == 4 )
-    {
-        for( uint32_t u = 0; u != atlas_width; ++u )
+        uint32_t cache_hits = 0;
+        uint32_t cache_unwritten = 0;
+        if( texpacker_load_texture_pixels( _data, NULL, &reload, &cache_hits, &cache_unwritten ) != 0 )
         {
-            for( uint32_t v = 0; v != atlas_height; ++v )
-            {
-                uint32_t atlas_offset = (u + v * atlas_width) * atlas_pixel_size;
+            printf( "watch: unable to load %s\n", texpacker_get_string( _data, texture->path ) );
 
-                uint32_t atlas_pixel_a = *(altas_pixels_byte + atlas_offset + 3);
+            //the texture still views the old sheet, which then has to outlive it
+            if( texture->sheet != TEXPACKER_SHEET_NONE )
+            {
+                sheets_stale[texture->sheet] = NULL;
+            }
 
-                if( atlas_pixel_a != 0 )
-                {
-                    continue;
-                }
+            continue;
+        }
 
-                uint32_t tr = 0;
-                uint32_t tg = 0;
-                uint32_t tb = 0;
+        if( texture->sheet == TEXPACKER_SHEET_NONE )
+        {
+            free( texture->pixels );
+        }
 
-                uint32_t count = 0;
+        if( reload.width != texture->width || reload.height != texture->height )
+        {
+            repack = 1;
+        }
 
-                texpacker_correct_atlas_alpha_pixel( u - 1, v - 1, _atlas, &tr, &tg, &tb, &count );
-                texpacker_correct_atlas_alpha_pixel( u - 1, v + 0, _atlas, &tr, &tg, &tb, &count );
-                texpacker_correct_atlas_alpha_pixel( u - 1, v + 1, _atlas, &tr, &tg, &tb, &count );
-                texpacker_correct_atlas_alpha_pixel( u + 0, v - 1, _atlas, &tr, &tg, &tb, &count );
-                texpacker_correct_atlas_alpha_pixel( u + 0, v + 1, _atlas, &tr, &tg, &tb, &count );
-                texpacker_correct_atlas_alpha_pixel( u + 1, v - 1, _atlas, &tr, &tg, &tb, &count );
-                texpacker_correct_atlas_alpha_pixel( u + 1, v + 0, _atlas, &tr, &tg, &tb, &count );
-                texpacker_correct_atlas_alpha_pixel( u + 1, v + 1, _atlas, &tr, &tg, &tb, &count );
+        //gaining or losing transparency moves the texture between rgb and rgba pages
+        if( reload.opaque != texture->opaque )
+        {
+            repack = 1;
+        }
 
-                if( count == 0 )
-                { 
-                    continue;
-                }
+        //hulls live in the atlas info, which only a repack writes
+        if( reload.trim_x != texture->trim_x || reload.trim_y != texture->trim_y || reload.hull_count != texture->hull_count )
+        {
+            repack = 1;
+        }
+        else if( reload.hull_count != 0 && memcmp( reload.hull, texture->hull, reload.hull_count * sizeof( texpacker_hull_point_t ) ) != 0 )
+        {
+            repack = 1;
+        }
 
-                uint32_t r = tr / count;
-                uint32_t g = tg / count;
-                uint32_t b = tb / count;
+        free( texture->hull );
+
+        texture->pixels = reload.pixels;
+        texture->width = reload.width;
+        texture->height = reload.height;
+        texture->channel = reload.channel;
+        texture->pixel_step = reload.pixel_step;
+        texture->row_step = reload.row_step;
+        texture->opaque = reload.opaque;
+        texture->trim_x = reload.trim_x;
+        texture->trim_y = reload.trim_y;
+        texture->source_width = reload.source_width;
+        texture->source_height = reload.source_height;
+        texture->hull_count = reload.hull_count;
+        texture->hull = reload.hull;
 
-                *(altas_pixels_byte + atlas_offset + 0) = (uint8_t)r;
-                *(altas_pixels_byte + atlas_offset + 1) = (uint8_t)g;
-                *(altas_pixels_byte + atlas_offset + 2) = (uint8_t)b;
-            }
+        if( texture->atlas != NULL )
+        {
+            atlases_dirty[texture->atlas->index] = 1;
         }
+
+        ++reloaded;
     }
-}
-//////////////////////////////////////////////////////////////////////////
-static int texpacker_make_atlas( const texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlas, uint32_t * const _packaged, uint32_t * const _unpackaged )
-{
-    if( _data->textures_count == 0 )
+
+    for( uint32_t index = 0; index != _data->sheets_count; ++index )
     {
-        return 0;
+        free( sheets_stale[index] );
     }
 
-    uint32_t base_max_width;
-    uint32_t base_max_height;
-    texpacker_get_texture_bounds_pow2( _data, &base_max_width, &base_max_height );
+    free( sheets_stale );
 
-    if( base_max_width > _data->atlas_max_width || base_max_height > _data->atlas_max_height )
+    if( reloaded == 0 )
     {
-        return 1;
-    }
-
-    texpacker_atlas_rect_t * r0 = NULL;
-    uint32_t packaged = 0;
-    uint32_t unpackaged = 0;
+        free( atlases_dirty );
 
-    uint32_t probe_width[] = {0, 1, 0, 1, 2, 1, 2, 3, 2, 3, 4, 3, 4, 5, 4, 5, 6, 5, 6, 7, 6, 7, 8, 7, 8, 9, 8, 9, 10, 9, 10, 9};
-    uint32_t probe_height[] = {0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 10};
+        return 0;
+    }
 
-    for( uint32_t atlas_probe = 0; atlas_probe != sizeof( probe_width ) / sizeof( uint32_t ); ++atlas_probe )
+    if( repack == 1 )
     {
-        uint32_t probe_atlas_width = base_max_width << probe_width[atlas_probe];
-        uint32_t probe_atlas_height = base_max_height << probe_height[atlas_probe];
+        free( atlases_dirty );
 
-        if( probe_atlas_width > _data->atlas_max_width || probe_atlas_height > _data->atlas_max_height )
+        for( uint32_t index = 0; index != *_atlases_count; ++index )
         {
-            continue;
+            texpacker_free_atlas( (*_atlases)[index] );
         }
 
+        free( *_atlases );
+
+        *_atlases = NULL;
+        *_atlases_count = 0;
+
         for( uint32_t index = 0; index != _data->textures_count; ++index )
         {
-            texpacker_texture_t * t = _data->textures + index;
-
-            if( t->atlas != NULL )
-            {
-                continue;
-            }
+            texpacker_texture_t * texture = _data->textures + index;
 
-            t->atlas_rect = NULL;
+            texture->atlas_rect = TEXPACKER_RECT_NONE;
+            texture->atlas = NULL;
         }
 
-        if( texpacker_probe_atlas_rect( probe_atlas_width, probe_atlas_height, _data, &r0, &packaged, &unpackaged ) != 0 )
+        if( texpacker_build_atlases( _data, _atlases, _atlases_count ) != 0 )
         {
             return 1;
         }
 
-        if( unpackaged == 0 )
+        printf( "watch: %u textures changed, repacked %u atlases\n", reloaded, *_atlases_count );
+
+        return 0;
+    }
+
+    uint32_t rebuilt = 0;
+
+    for( uint32_t index = 0; index != *_atlases_count; ++index )
+    {
+        if( atlases_dirty[index] == 0 )
         {
-            break;
+            continue;
         }
-    }
 
-    texpacker_atlas_t * atlas = TEXPACKER_NEW( texpacker_atlas_t );
+        texpacker_atlas_t * atlas = (*_atlases)[index];
 
-    atlas->width = r0->w;
-    atlas->height = r0->h;
-    atlas->channel = _data->atlas_channels;
+        if( atlas->pixels != NULL )
+        {
+            memset( atlas->pixels, 0x00, (size_t)atlas->width * atlas->height * atlas->channel );
 
-    uint32_t atlas_width = atlas->width;
-    uint32_t atlas_height = atlas->height;
-    uint32_t atlas_channel = atlas->channel;
+            uint64_t render_begin = texpacker_trace_begin( _data );
 
-    size_t atlas_pixels_size = atlas_width * atlas_height * atlas_channel * sizeof( uint8_t );
-    void * atlas_pixels = malloc( atlas_pixels_size );
-    memset( atlas_pixels, 0x00, atlas_pixels_size );
+            texpacker_render_atlas( _data, atlas );
 
-    atlas->pixels = atlas_pixels;
+            texpacker_trace_end( _data, "render", render_begin, TEXPACKER_TRACE_NONE, atlas->index );
 
-    texpacker_render_atlas( _data, atlas );
-    texpacker_correct_atlas_alpha_pixels( atlas );
+            uint64_t bleed_begin = texpacker_trace_begin( _data );
 
-    *_atlas = atlas;
-    *_packaged = packaged;
-    *_unpackaged = unpackaged;
+            texpacker_correct_atlas_alpha_pixels( atlas, 0, atlas->height );
 
-    return 0;
-}
-//////////////////////////////////////////////////////////////////////////
-static void __texpacker_stbi_write( void * _context, void * _data, int _size )
-{
-    FILE * f = (FILE *)_context;
+            texpacker_trace_end( _data, "bleed", bleed_begin, TEXPACKER_TRACE_NONE, atlas->index );
+        }
 
-    fwrite( _data, _size, 1, f );
-}
-//////////////////////////////////////////////////////////////////////////
-static int texpacker_save_atlas( texpacker_in_data_t * const _data, texpacker_atlas_t * _atlas, uint32_t _index )
-{
-    wchar_t output_path[FILENAME_MAX];
+        if( texpacker_save_atlas( _data, atlas, atlas->index ) != 0 )
+        {
+            free( atlases_dirty );
 
-    if( _index == 0 )
-    {
-        wcscpy( output_path, _data->output_atlas_path );
-    }
-    else
-    {
-        const wchar_t * output_path_format = (_data->output_atlas_path_format != NULL) ? _data->output_atlas_path_format : L"%.*s_%02u%s";
-        
-        swprintf( output_path, FILENAME_MAX, output_path_format, _data->output_atlas_path_ext - _data->output_atlas_path, _data->output_atlas_path, _index, _data->output_atlas_path_ext );
+            return 1;
+        }
+
+        ++rebuilt;
     }
 
-    FILE * f = _wfopen( output_path, L"wb" );
+    free( atlases_dirty );
 
-    if( f == NULL )
+    if( _data->output_array_path != NULL )
     {
-        return 1;
+        if( texpacker_save_atlas_array( _data, *_atlases, *_atlases_count ) != 0 )
+        {
+            return 1;
+        }
     }
 
-    int stbi_result = stbi_write_png_to_func( &__texpacker_stbi_write, f, _atlas->width, _atlas->height, _atlas->channel, _atlas->pixels, _atlas->width * _atlas->channel );
-
-    fclose( f );
-
-    if( stbi_result == 0 )
+    if( _data->output_tiles_path != NULL )
     {
-        return 1;
+        if( texpacker_save_atlas_tiles( _data, *_atlases, *_atlases_count ) != 0 )
+        {
+            return 1;
+        }
     }
 
-    _atlas->index = _index;
-    wcscpy( _atlas->path, output_path );
+    printf( "watch: %u textures changed, rebuilt %u atlases\n", reloaded, rebuilt );
 
     return 0;
 }
 //////////////////////////////////////////////////////////////////////////
-static int texpacker_save_atlas_info( texpacker_in_data_t * const _data, texpacker_atlas_t ** const _atlases, uint32_t _atlases_count )
+static int texpacker_watch( texpacker_in_data_t * const _data, texpacker_atlas_t *** const _atlases, uint32_t * const _atlases_count )
 {
-    json_t * j = json_object();
-
-    json_t * j_atlases = json_array();
-
-    for( uint32_t i = 0; i != _atlases_count; ++i )
+    for( uint32_t index = 0; index != _data->textures_count; ++index )
     {
-        texpacker_atlas_t * atlas = _atlases[i];
+        texpacker_texture_t * texture = _data->textures + index;
 
-        json_t * j_atlas = json_object();
+        if( texpacker_stat_file( _data, texture->path, &texture->file_time, &texture->file_size ) != 0 )
+        {
+            texture->file_time = 0;
+            texture->file_size = 0;
+        }
 
-        char mbstr_atlas_path[FILENAME_MAX];
-        wcstombs( mbstr_atlas_path, atlas->path, FILENAME_MAX );
+        texture->file_dirty = 0;
+    }
 
-        json_object_set_new( j_atlas, "path", json_string( mbstr_atlas_path ) );
-        json_object_set_new( j_atlas, "w", json_integer( atlas->width ) );
-        json_object_set_new( j_atlas, "h", json_integer( atlas->height ) );
+    for( uint32_t index = 0; index != _data->sheets_count; ++index )
+    {
+        texpacker_sheet_t * sheet = _data->sheets + index;
 
-        json_array_append_new( j_atlases, j_atlas );
+        if( texpacker_stat_file( _data, sheet->path, &sheet->file_time, &sheet->file_size ) != 0 )
+        {
+            sheet->file_time = 0;
+            sheet->file_size = 0;
+        }
+
+        sheet->file_dirty = 0;
     }
 
-    json_object_set_new( j, "atlases", j_atlases );
+    printf( "watch: %u textures\n", _data->textures_count );
 
-    json_t * j_textures = json_array();
+    fflush( stdout );
 
-    uint32_t textures_count = _data->textures_count;
+    uint32_t pending = 0;
+    uint32_t quiet = 0;
 
-    for( uint32_t i = 0; i != textures_count; ++i )
+    for( ;; )
     {
-        const texpacker_texture_t * texture = _data->textures + i;
-
-        json_t * j_texture = json_object();
+        texpacker_sleep( TEXPACKER_WATCH_POLL_MS );
 
-        char mbstr_texture_path[FILENAME_MAX];
-        wcstombs( mbstr_texture_path, texture->path, FILENAME_MAX );
+        uint32_t changed = texpacker_watch_poll( _data );
 
-        json_object_set_new( j_texture, "path", json_string( mbstr_texture_path ) );
-        json_object_set_new( j_texture, "atlas", json_integer( texture->atlas->index ) );
-
-        uint32_t atlas_border = _data->atlas_border;
+        if( changed != 0 )
+        {
+            pending += changed;
+            quiet = 0;
 
-        float atlas_width_inv = 1.f / (float)texture->atlas->width;
-        float atlas_height_inv = 1.f / (float)texture->atlas->height;
+            continue;
+        }
 
-        float uv_x = (float)(texture->atlas_rect->x + atlas_border) * atlas_width_inv;
-        float uv_y = (float)(texture->atlas_rect->y + atlas_border) * atlas_height_inv;
-        float uv_u = (float)(texture->atlas_rect->u - atlas_border) * atlas_width_inv;
-        float uv_v = (float)(texture->atlas_rect->v - atlas_border) * atlas_height_inv;
+        if( pending == 0 || ++quiet < TEXPACKER_WATCH_DEBOUNCE_POLLS )
+        {
+            continue;
+        }
 
-        json_object_set_new( j_texture, "x", json_real( uv_x ) );
-        json_object_set_new( j_texture, "y", json_real( uv_y ) );
-        json_object_set_new( j_texture, "u", json_real( uv_u ) );
-        json_object_set_new( j_texture, "v", json_real( uv_v ) );
+        uint64_t time_begin = texpacker_get_time_ms();
+        uint64_t trace_begin = texpacker_trace_begin( _data );
 
-        if( texture->atlas_rect->rotate == 1 )
+        if( texpacker_watch_update( _data, _atlases, _atlases_count ) != 0 )
         {
-            json_object_set_new( j_texture, "rotate", json_true() );
+            printf( "watch: update failed\n" );
         }
 
-        json_array_append_new( j_textures, j_texture );
-    }
-
-    json_object_set_new( j, "textures", j_textures );
-    
-    FILE * f = _wfopen( _data->output_atlas_info, L"wb" );
+        uint64_t time_end = texpacker_get_time_ms();
 
-    if( f == NULL )
-    {
-        return 1;
-    }
+        if( _data->trace != NULL )
+        {
+            texpacker_trace_end( _data, "watch", trace_begin, TEXPACKER_TRACE_NONE, TEXPACKER_TRACE_NONE );
 
-    int res = json_dumpf( j, f, JSON_INDENT( 2 ) );
+            if( texpacker_trace_save( _data ) != 0 )
+            {
+                printf( "trace: unable to write\n" );
+            }
+        }
 
-    json_decref( j );
+        printf( "watch: done in %u ms\n", (uint32_t)(time_end - time_begin) );
 
-    fclose( f );
+        fflush( stdout );
 
-    if( res != 0 )
-    {
-        return 1;
+        pending = 0;
+        quiet = 0;
     }
 
     return 0;
@@ -1140,11 +9081,40 @@ static int texpacker_save_atlas_info( texpacker_in_data_t * const _data, texpack
 //////////////////////////////////////////////////////////////////////////
 int wmain( int argc, wchar_t * argv[] )
 {
-    if( argc != 2 )
+    if( argc < 2 )
     {
         return EXIT_FAILURE;
     }
 
+    uint32_t watch = 0;
+    const wchar_t * time_budget = NULL;
+    const wchar_t * effort = NULL;
+    const wchar_t * trace = NULL;
+
+    for( int arg = 2; arg != argc; ++arg )
+    {
+        if( wcscmp( argv[arg], L"--watch" ) == 0 )
+        {
+            watch = 1;
+        }
+        else if( wcscmp( argv[arg], L"--time-budget" ) == 0 && arg + 1 != argc )
+        {
+            time_budget = argv[++arg];
+        }
+        else if( wcscmp( argv[arg], L"--effort" ) == 0 && arg + 1 != argc )
+        {
+            effort = argv[++arg];
+        }
+        else if( wcscmp( argv[arg], L"--trace" ) == 0 && arg + 1 != argc )
+        {
+            trace = argv[++arg];
+        }
+        else
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
     const wchar_t * data_path = argv[1];
 
     void * data_buffer;
@@ -1165,81 +9135,96 @@ int wmain( int argc, wchar_t * argv[] )
 
     free( data_buffer );
 
-    if( texpacker_load_texures_pixels( &in_data ) != 0 )
-    {
-        return EXIT_FAILURE;
-    }
-
-    if( texpacker_load_texures_sort( &in_data ) != 0 )
+    if( time_budget != NULL )
     {
-        return EXIT_FAILURE;
+        in_data.atlas_time_budget = (uint32_t)wcstoul( time_budget, NULL, 10 );
     }
 
-    texpacker_atlas_t * atlases[256];
-    uint32_t atlases_count = 0;
-    for( uint32_t index = 0;; ++index )
+    if( effort != NULL )
     {
-        if( atlases_count == 256 )
-        {
-            return EXIT_FAILURE;
-        }
-
-        texpacker_atlas_t * atlas;
-        uint32_t packaged;
-        uint32_t unpackaged;
-        if( texpacker_make_atlas( &in_data, &atlas, &packaged, &unpackaged ) != 0 )
-        {
-            return EXIT_FAILURE;
-        }
-
-        //if( texpacker_correct_pixels_atlas( atlas, index ) != 0 )
+        char effort_name[16] = {'\0'};
+        wcstombs( effort_name, effort, sizeof( effort_name ) - 1 );
 
-        if( texpacker_save_atlas( &in_data, atlas, index ) != 0 )
+        if( texpacker_parse_effort( effort_name, &in_data.atlas_effort ) != 0 )
         {
             return EXIT_FAILURE;
         }
+    }
 
-        atlases[index] = atlas;
-        ++atlases_count;
+    texpacker_apply_effort( &in_data );
 
-        if( unpackaged == 0 )
-        {
-            break;
-        }
+    if( trace != NULL )
+    {
+        in_data.trace = texpacker_trace_create( trace );
     }
 
-    for( uint32_t i = 0; i != in_data.textures_count; ++i )
+    if( texpacker_load_texures_pixels( &in_data ) != 0 )
     {
-        const texpacker_texture_t * texture = in_data.textures + i;
-
-        if( texture->atlas == NULL )
-        {
-            return EXIT_FAILURE;
-        }
+        return EXIT_FAILURE;
     }
 
-    if( texpacker_save_atlas_info( &in_data, atlases, atlases_count ) != 0 )
+    texpacker_atlas_t ** atlases;
+    uint32_t atlases_count;
+    if( texpacker_build_atlases( &in_data, &atlases, &atlases_count ) != 0 )
     {
         return EXIT_FAILURE;
     }
 
-    for( uint32_t i = 0; i != in_data.textures_count; ++i )
+    if( in_data.trace != NULL )
     {
-        const texpacker_texture_t * texture = in_data.textures + i;
-
-        printf( "texture: %ls atlas %ls uv %u %u\n", texture->path, texture->atlas->path, texture->atlas_rect->x, texture->atlas_rect->y );
+        if( texpacker_trace_save( &in_data ) != 0 )
+        {
+            return EXIT_FAILURE;
+        }
     }
 
     for( uint32_t i = 0; i != in_data.textures_count; ++i )
     {
-        const texpacker_texture_t * texture = in_data.textures + i;
+        const texpacker_texture_t * texture = in_data.textures + in_data.pack->order[i];
 
-        const wchar_t * path = texture->path;
+        const texpacker_atlas_rect_t * atlas_rect = texpacker_get_texture_rect( texture );
 
-        free( (void *)path );
+        printf( "texture: %s atlas %ls uv %u %u\n", texpacker_get_string( &in_data, texture->path ), texture->atlas->path, atlas_rect->x, atlas_rect->y );
+    }
+
+    if( watch == 1 )
+    {
+        if( texpacker_watch( &in_data, &atlases, &atlases_count ) != 0 )
+        {
+            return EXIT_FAILURE;
+        }
     }
 
     free( (void *)in_data.textures );
+    free( in_data.sheets );
+    free( in_data.groups );
+
+    free( in_data.strings.buffer );
+    free( in_data.strings.table );
+
+    texpacker_pack_state_t * pack = in_data.pack;
+
+    free( pack->order );
+    free( pack->keys );
+    free( pack->width );
+    free( pack->height );
+    free( pack->footprint_width );
+    free( pack->footprint_height );
+    free( pack->placement );
+    free( pack->page );
+    free( pack->group );
+    free( pack->opaque );
+    free( pack->group_count );
+    free( pack->group_cursor );
+    free( pack->pending );
+    free( pack->rects );
+    free( pack->undo );
+    free( pack );
+
+    if( in_data.trace != NULL )
+    {
+        texpacker_trace_destroy( in_data.trace );
+    }
 
     return EXIT_SUCCESS;
 }